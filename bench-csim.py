@@ -0,0 +1,223 @@
+#!/usr/bin/env python
+#
+# bench-csim.py - Measures how fast ./csim simulates. It runs the
+#     simulator across a fixed matrix of traces and cache geometries,
+#     reports accesses per second, ns per access, peak RSS and the
+#     parse / simulate time split (from csim -T), and writes the
+#     results as JSON. Given a baseline JSON from an earlier run, it
+#     first fails if any configuration's hits, misses or evictions
+#     changed (a faster simulator that gives different answers is not
+#     an improvement), then flags every configuration whose throughput
+#     dropped by more than the threshold and exits non-zero, so it can
+#     gate hot path changes.
+#
+from __future__ import print_function
+import json
+import optparse
+import os
+import platform
+import subprocess
+import sys
+import time
+
+#
+# The benchmark matrix. Synthetic traces are named synthtrace presets,
+# generated once into the corpus directory with a reduced access count.
+#
+CHECKED_IN_TRACES = ["traces/long.trace"]
+SYNTH_PRESETS = ["small-mixed", "seq-1g", "stride-4k", "uniform-64m",
+                 "zipf-hot", "chase-16m"]
+
+# (s, E, b): direct-mapped through 64-way, 1 to 20 set bits
+GEOMETRIES = [
+    (1, 1, 5),
+    (5, 1, 5),
+    (10, 1, 6),
+    (20, 1, 6),
+    (8, 2, 6),
+    (10, 4, 6),
+    (16, 4, 6),
+    (12, 8, 6),
+    (10, 16, 6),
+    (6, 64, 6),
+]
+
+#
+# build_corpus - Generate any missing synthetic traces, returns their paths
+#
+def build_corpus(corpus_dir, count):
+    if not os.path.isdir(corpus_dir):
+        os.makedirs(corpus_dir)
+    paths = []
+    for preset in SYNTH_PRESETS:
+        path = os.path.join(corpus_dir, "%s-%d.bin" % (preset, count))
+        if not os.path.exists(path):
+            print("Generating %s" % path)
+            subprocess.check_call(["./synthtrace", "-c", preset, "-n", str(count),
+                                   "-B", "-o", path])
+        paths.append(path)
+    return paths
+
+#
+# summary_fields - The key:value fields of the first line of text that
+#     starts with prefix (csim's summary or its -T timing line); other
+#     output, such as the reports of the analyses, is skipped
+#
+def summary_fields(text, prefix, cmd):
+    for line in text.decode().splitlines():
+        if line.startswith(prefix):
+            return dict((key, float(value)) for key, value in
+                        (field.split(":", 1) for field in line.split() if ":" in field))
+    raise RuntimeError("%s printed no line starting with %r" % (" ".join(cmd), prefix))
+
+#
+# run_once - Run csim once, returns (wall seconds, peak RSS in KB, results)
+#     where results holds the hits/misses/evictions summary and the
+#     csim -T timing fields
+#
+def run_once(trace, s, E, b):
+    cmd = ["./csim", "-T", "-s", str(s), "-E", str(E), "-b", str(b), "-t", trace]
+    start = time.time()
+    p = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    # both outputs are a single line, so reading them in turn can't block
+    out = p.stdout.read()
+    err = p.stderr.read()
+    _, status, usage = os.wait4(p.pid, 0)
+    wall = time.time() - start
+    p.returncode = status
+    if status != 0:
+        raise RuntimeError("%s failed: %s" % (" ".join(cmd), err))
+
+    timing = summary_fields(err, "accesses:", cmd)
+    timing.update(summary_fields(out, "hits:", cmd))
+    # ru_maxrss is KB on Linux, bytes on macOS
+    rss = usage.ru_maxrss
+    if platform.system() == "Darwin":
+        rss //= 1024
+    return wall, rss, timing
+
+#
+# bench - Run the whole matrix, keeping the fastest of `repeat` runs
+#
+def bench(traces, repeat):
+    results = []
+    for trace in traces:
+        for (s, E, b) in GEOMETRIES:
+            best = None
+            for _ in range(repeat):
+                run = run_once(trace, s, E, b)
+                if best is None or run[2]["total_s"] < best[2]["total_s"]:
+                    best = run
+            wall, rss, timing = best
+            accesses = max(int(timing["accesses"]), 1)
+            entry = {
+                "trace": trace,
+                "s": s, "E": E, "b": b,
+                "accesses": accesses,
+                "hits": int(timing["hits"]),
+                "misses": int(timing["misses"]),
+                "evictions": int(timing["evictions"]),
+                "wall_s": wall,
+                "parse_s": timing["parse_s"],
+                "simulate_s": timing["simulate_s"],
+                "total_s": timing["total_s"],
+                "accesses_per_s": accesses / max(timing["total_s"], 1e-9),
+                "ns_per_access": timing["total_s"] * 1e9 / accesses,
+                "sim_ns_per_access": timing["simulate_s"] * 1e9 / accesses,
+                "peak_rss_kb": rss,
+                "cache_bytes": int(timing.get("cache_bytes", 0)),
+            }
+            results.append(entry)
+            print("%-36s s=%-2d E=%-2d b=%d %12.0f acc/s %8.1f ns/acc "
+                  "(parse %5.1f%%) %8d KB" %
+                  (os.path.basename(trace), s, E, b, entry["accesses_per_s"],
+                   entry["ns_per_access"],
+                   100.0 * entry["parse_s"] / max(entry["total_s"], 1e-9),
+                   entry["peak_rss_kb"]))
+            sys.stdout.flush()
+    return results
+
+#
+# baseline_results - The baseline's results by configuration
+#
+def baseline_results(baseline):
+    return dict(((r["trace"], r["s"], r["E"], r["b"]), r) for r in baseline["results"])
+
+#
+# check_results - Compare hits, misses and evictions with the baseline.
+#     Returns the number of configurations whose counts changed.
+#
+def check_results(results, baseline):
+    old = baseline_results(baseline)
+    changed = 0
+    for r in results:
+        o = old.get((r["trace"], r["s"], r["E"], r["b"]))
+        if o is None:
+            continue
+        if (r["hits"], r["misses"], r["evictions"]) != (o["hits"], o["misses"], o["evictions"]):
+            print("%-36s s=%-2d E=%-2d b=%d RESULTS CHANGED: hits:%d misses:%d evictions:%d, "
+                  "baseline hits:%d misses:%d evictions:%d" %
+                  (os.path.basename(r["trace"]), r["s"], r["E"], r["b"], r["hits"],
+                   r["misses"], r["evictions"], o["hits"], o["misses"], o["evictions"]))
+            changed += 1
+    return changed
+
+#
+# compare - Compare throughput against a baseline. Returns the number of
+#     regressions.
+#
+def compare(results, baseline, threshold):
+    old = baseline_results(baseline)
+    regressions = 0
+    print("\nComparison against baseline (threshold %.1f%%)" % threshold)
+    for r in results:
+        o = old.get((r["trace"], r["s"], r["E"], r["b"]))
+        if o is None:
+            continue
+        change = 100.0 * (r["accesses_per_s"] - o["accesses_per_s"]) / o["accesses_per_s"]
+        status = "ok"
+        if change < -threshold:
+            status = "REGRESSION"
+            regressions += 1
+        print("%-36s s=%-2d E=%-2d b=%d %+7.1f%% %s" %
+              (os.path.basename(r["trace"]), r["s"], r["E"], r["b"], change, status))
+    return regressions
+
+def main():
+    p = optparse.OptionParser()
+    p.add_option("-o", "--output", default="bench_results.json",
+                 help="Where to write the JSON results")
+    p.add_option("-B", "--baseline", help="Baseline JSON to compare against")
+    p.add_option("-r", "--threshold", type="float", default=5.0,
+                 help="Allowed throughput drop in percent (default 5)")
+    p.add_option("-n", "--count", type="int", default=2000000,
+                 help="Accesses per synthetic trace (default 2000000)")
+    p.add_option("-c", "--corpus", default="bench",
+                 help="Directory for the generated traces")
+    p.add_option("-R", "--repeat", type="int", default=3,
+                 help="Runs per configuration, the fastest is kept")
+    opts, _ = p.parse_args()
+
+    traces = CHECKED_IN_TRACES + build_corpus(opts.corpus, opts.count)
+    results = bench(traces, opts.repeat)
+
+    out = open(opts.output, "w")
+    json.dump({"host": platform.node(), "time": time.time(),
+               "count": opts.count, "results": results}, out, indent=1)
+    out.close()
+    print("\nWrote %s" % opts.output)
+
+    if opts.baseline:
+        baseline = json.load(open(opts.baseline))
+        changed = check_results(results, baseline)
+        if changed:
+            print("%d configuration(s) changed hits, misses or evictions, "
+                  "not comparing throughput" % changed)
+            sys.exit(1)
+        regressions = compare(results, baseline, opts.threshold)
+        if regressions:
+            print("%d configuration(s) regressed" % regressions)
+            sys.exit(1)
+
+if __name__ == "__main__":
+    main()
@@ -5,6 +5,8 @@
 #ifndef CACHELAB_TOOLS_H
 #define CACHELAB_TOOLS_H
 
+#include <stddef.h>
+
 #define MAX_TRANS_FUNCS 100
 
 typedef struct trans_func{
@@ -34,4 +36,12 @@ void correctTrans(int M, int N, int A[N][M], int B[M][N]);
 void registerTransFunction(
     void (*trans)(int M,int N,int[N][M],int[M][N]), char* desc);
 
+/* Out-of-place transpose of an N x M matrix with 1, 2, 4, 8 or 16 byte
+   elements. Returns -1 for any other element size. */
+int transpose_generic(size_t elemSize, int M, int N, const void *A, void *B);
+
+/* In-place transpose of an N x N matrix with 1, 2, 4, 8 or 16 byte
+   elements. Returns -1 for any other element size. */
+int transpose_square_inplace(size_t elemSize, int N, void *A);
+
 #endif /* CACHELAB_TOOLS_H */
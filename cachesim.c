@@ -0,0 +1,323 @@
+/* Set-associative LRU cache simulator.
+ * There is a generic simulator for any number of lines per set and specialized ones for 1, 2, 4, 8
+ * and 16, each for dense storage (every set allocated up front) and sparse storage (sets
+ * allocated a page at a time on first use).
+ *
+ * Authors: Theodore Bieber (tjbieber), James Honicker (jlhonicker)
+*/
+#include "cachesim.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int getEmptyLine(cacheSet set, cacheData data);
+int findEvictee(cacheSet set, cacheData cData, unsigned long long *usedLines);
+
+// Returns the lines of a set of a dense cache
+static inline cacheSetLine *getDenseSetLines(cache theCache, unsigned long long setcounter) {
+	return theCache.allLines + setcounter * theCache.lines;
+}
+
+/* Returns the lines of a set of a sparse cache
+ * The page holding the set is allocated (empty) the first time it is touched.
+*/
+static inline cacheSetLine *getSparseSetLines(cache theCache, unsigned long long setcounter) {
+	cacheSetLine **page = &theCache.pages[setcounter >> theCache.pageBits];
+	if(*page == NULL) {
+		*page = (cacheSetLine *) calloc((size_t) theCache.lines << theCache.pageBits,
+			sizeof(cacheSetLine));
+		if(*page == NULL) {
+			printf("Out of memory for the cache's sets\n");
+			exit(1);
+		}
+	}
+	return *page + (setcounter & ((1ULL << theCache.pageBits) - 1)) * theCache.lines;
+}
+
+/* Simulates one access to a set, updating the summary data for each call.
+ * This is the generic simulator, it works for any number of lines per set. The main loop uses
+ * one of the specialized simulators below instead when there is one for E.
+ * Uses getEmptyLine and findEvictee (below), and is called through simulateCache or
+ * simulateSparseCache
+ * Parameters:
+ *     setLines: the lines of the set the address maps to
+ *     cData: the information about the cache, its hits, misses and evictions are updated
+ *     address: the address that we are trying to access.
+ *              this is the only parameter that changes between each run of this function
+*/
+static inline void simulateSet(cacheSetLine *setLines, cacheData *cData, address_t address) {
+	int linecounter; // line index
+	int cacheFull = 1;
+
+	int lines = cData->E; 
+
+	address_t cacheLineTag = address >> cData->tagShift;
+
+	cacheSet set;
+	set.lines = setLines;
+	cData->clock++;
+
+	for(linecounter = 0; linecounter < lines; linecounter++) {
+		cacheSetLine line = set.lines[linecounter];
+
+		if(line.valid) {
+			if(line.tag == cacheLineTag) {
+				// a hit makes the line the most recently used one
+				set.lines[linecounter].lastUsed = cData->clock;
+				cData->hits++;
+				return;
+			}
+		} else if(!line.valid && cacheFull) {
+			// update flag because we know there's an empty line
+			cacheFull = 0;
+		}
+	}
+
+	cData->misses++;
+
+	// Since we missed, we need to find a spot to take, either evict or find empty space
+
+	unsigned long long usedLines[2]; // index 0 is minUsed, 1 is maxUsed
+
+	if(cacheFull) {
+		// Find and evict the least recently used line
+		int minUsedIndex = findEvictee(set, *cData, usedLines);
+		cData->evictions++;
+		set.lines[minUsedIndex].tag = cacheLineTag;
+		set.lines[minUsedIndex].lastUsed = cData->clock;
+	} else { // there is an empty spot, so we just need to find it
+		int emptycounter = getEmptyLine(set, *cData);
+		set.lines[emptycounter].tag = cacheLineTag;
+		set.lines[emptycounter].valid = 1;
+		set.lines[emptycounter].lastUsed = cData->clock;
+	}
+}
+
+/* The generic simulator for each storage. pickSimulator chooses between them once, so a dense
+ * cache never pays for the sparse page lookup on each access.
+*/
+void simulateCache(cache theCache, cacheData *cData, address_t address) {
+	simulateSet(getDenseSetLines(theCache, (address >> cData->blocks) & cData->setMask), cData,
+		address);
+}
+
+void simulateSparseCache(cache theCache, cacheData *cData, address_t address) {
+	simulateSet(getSparseSetLines(theCache, (address >> cData->blocks) & cData->setMask), cData,
+		address);
+}
+
+/* Specialized simulators.
+ * DEFINE_SIMULATOR stamps out a copy of the simulator for a fixed number of lines per set, so
+ * the compiler can fully unroll the line loop. The loop has no early exit and no branches: the
+ * hit line and the LRU victim are both picked with selects. Empty lines have lastUsed 0, so the
+ * LRU search finds the first empty line before any valid one, exactly like the generic simulator
+ * (which takes the first empty line, or else the least recently used one).
+*/
+#define DEFINE_SIMULATOR(LINES) \
+static inline void simulateSet##LINES(cacheSetLine *lines, cacheData *cData, address_t address) { \
+	address_t cacheLineTag = address >> cData->tagShift; \
+	int hitIndex = -1; \
+	int victimIndex = 0; \
+	unsigned long long minUsed = lines[0].lastUsed; \
+	int linecounter; \
+ \
+	cData->clock++; \
+	for(linecounter = 0; linecounter < LINES; linecounter++) { \
+		unsigned long long used = lines[linecounter].lastUsed; \
+		int match = lines[linecounter].valid & (lines[linecounter].tag == cacheLineTag); \
+		int older = used < minUsed; \
+		hitIndex = match ? linecounter : hitIndex; \
+		victimIndex = older ? linecounter : victimIndex; \
+		minUsed = older ? used : minUsed; \
+	} \
+ \
+	if(hitIndex >= 0) { \
+		lines[hitIndex].lastUsed = cData->clock; \
+		cData->hits++; \
+		return; \
+	} \
+	cData->misses++; \
+	cData->evictions += lines[victimIndex].valid; \
+	lines[victimIndex].tag = cacheLineTag; \
+	lines[victimIndex].valid = 1; \
+	lines[victimIndex].lastUsed = cData->clock; \
+} \
+ \
+void simulateCache##LINES(cache theCache, cacheData *cData, address_t address) { \
+	simulateSet##LINES(getDenseSetLines(theCache, (address >> cData->blocks) & cData->setMask), \
+		cData, address); \
+} \
+ \
+void simulateSparseCache##LINES(cache theCache, cacheData *cData, address_t address) { \
+	simulateSet##LINES(getSparseSetLines(theCache, (address >> cData->blocks) & cData->setMask), \
+		cData, address); \
+}
+
+DEFINE_SIMULATOR(1)
+DEFINE_SIMULATOR(2)
+DEFINE_SIMULATOR(4)
+DEFINE_SIMULATOR(8)
+DEFINE_SIMULATOR(16)
+
+/* Picks the simulator for a number of lines per set and a storage, once at startup
+ * Parameters:
+ *     lines: E
+ *     sparse: whether the cache was generated with sparse storage
+ *     generic: always use the generic simulator (-G)
+ * return: a specialized simulator, or the generic one if there is none for lines
+*/
+simulateFunction pickSimulator(int lines, int sparse, int generic) {
+	if(sparse) {
+		switch(generic ? 0 : lines) {
+		case 1: return simulateSparseCache1;
+		case 2: return simulateSparseCache2;
+		case 4: return simulateSparseCache4;
+		case 8: return simulateSparseCache8;
+		case 16: return simulateSparseCache16;
+		default: return simulateSparseCache;
+		}
+	}
+	switch(generic ? 0 : lines) {
+	case 1: return simulateCache1;
+	case 2: return simulateCache2;
+	case 4: return simulateCache4;
+	case 8: return simulateCache8;
+	case 16: return simulateCache16;
+	default: return simulateCache;
+	}
+}
+
+/* Fills in everything about the cache that follows from -s, -E and -b
+ * return: the cacheData with S, B, setMask and tagShift set and the LRU clock reset
+*/
+cacheData finishGeometry(cacheData data) {
+	data.S = 1<<(data.sets);
+	data.B = 1<<(data.blocks);
+	data.setMask = (1ULL << data.sets) - 1;
+	data.tagShift = data.sets + data.blocks;
+	data.clock = 0;
+	return data;
+}
+
+/* Build the cache according to the specifications.
+ * Allocates the space using calloc
+ * From the cacheData: sets = S, lines = E, blockSize = B
+ * With sparse set, only a table of page pointers is allocated up front, and getSparseSetLines
+ * allocates each page of sets the first time one of its sets is used. Otherwise every line is
+ * allocated (empty) in one block.
+ * returns the cache.
+ * Note: we don't ever actually use blockSize, but I'm putting it there because
+ *     if we were actually creating a real cache it would be needed.
+*/
+cache generateCache(long long sets, int lines, long long blockSize, int sparse) {
+	cache generatedCache;
+
+	generatedCache.lines = lines;
+	generatedCache.allLines = NULL;
+	generatedCache.pages = NULL;
+	generatedCache.pageBits = 0;
+
+	if(sparse) {
+		// a page never holds more sets than the cache has
+		while(generatedCache.pageBits < SPARSE_PAGE_BITS && (1LL << generatedCache.pageBits) < sets) {
+			generatedCache.pageBits++;
+		}
+		generatedCache.pages = (cacheSetLine **) calloc(sets >> generatedCache.pageBits,
+			sizeof(cacheSetLine *));
+		return generatedCache;
+	}
+
+	// allocate the space for all of the sets' lines in one block, zeroed (empty lines)
+	generatedCache.allLines = (cacheSetLine *) calloc(sets * lines, sizeof(cacheSetLine));
+
+	return generatedCache;
+}
+
+/* Returns how many bytes the cache's sets take up, which for sparse storage
+ * depends on how much of the cache the trace touched
+*/
+unsigned long long cacheFootprint(cache theCache, long long sets) {
+	unsigned long long pageBytes = sizeof(cacheSetLine) * ((unsigned long long) theCache.lines << theCache.pageBits);
+	unsigned long long bytes;
+	long long pagecounter;
+
+	if(theCache.pages == NULL) {
+		return sizeof(cacheSetLine) * theCache.lines * (unsigned long long) sets;
+	}
+	bytes = sizeof(cacheSetLine *) * (sets >> theCache.pageBits);
+	for(pagecounter = 0; pagecounter < sets >> theCache.pageBits; pagecounter++) {
+		if(theCache.pages[pagecounter] != NULL) {
+			bytes += pageBytes;
+		}
+	}
+	return bytes;
+}
+
+/* Deallocates the memory used by the cache.
+ * Note: we don't ever actually use blockSize, but I'm putting it there because
+ *     if we were actually creating a real cache it would be needed.
+*/
+void freeCache(cache theCache, long long sets, int lines, long long blockSize) {
+	if(theCache.pages != NULL) {
+		long long pagecounter;
+		for(pagecounter = 0; pagecounter < sets >> theCache.pageBits; pagecounter++) {
+			free(theCache.pages[pagecounter]);
+		}
+		free(theCache.pages);
+	}
+	free(theCache.allLines);
+}
+
+/* Finds an empty line in the given set by checking the valid bit
+ * If for some reason there are no empty lines, it returns -1
+ * Parameters:
+ * 	   set: the set you are looking for an empty line in
+ *     data: the information about the cache
+ * return: the index of the line that is free
+ 		-1 indicates that there were no free lines
+*/
+int getEmptyLine(cacheSet set, cacheData data) {
+	int lines = data.E;
+	int index;
+	cacheSetLine line;
+
+	for(index = 0; index < lines; index++) {
+		line = set.lines[index];
+		if(line.valid == 0) {
+			return index;
+		}
+	}
+	return -1;
+}
+
+/* Finds the index of the least recently used line with a simple search
+ * Parameters:
+ *     set: the set you are evicting from
+ *     cData: the information about the cache
+ *     usedLines: a small array that is given minUsed and maxUsed as a side effect
+ * return: the index of the line being evicted
+*/
+int findEvictee(cacheSet set, cacheData cData, unsigned long long *usedLines) {
+	int lines = cData.E;
+	unsigned long long maxUsed = set.lines[0].lastUsed;
+	unsigned long long minUsed = set.lines[0].lastUsed;
+	int minUsedIndex = 0;
+
+	cacheSetLine line;
+	int linecounter;
+
+	for(linecounter = 1; linecounter < lines; linecounter++) {
+		line = set.lines[linecounter];
+
+		if(minUsed > line.lastUsed) {
+			minUsedIndex = linecounter;
+			minUsed = line.lastUsed;
+		}
+
+		if(maxUsed < line.lastUsed) {
+			maxUsed = line.lastUsed;
+		}
+	}
+	usedLines[0] = minUsed;
+	usedLines[1] = maxUsed;
+	return minUsedIndex;
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+/* Set-associative LRU cache simulator.
+ * The cache is stored as a series of structs, cache has cacheSet s, the cacheSet has cacheLine s
+ * and the cacheLine has a cache's line information. csim and csimd both simulate with these
+ * functions, so the server always gives the same hits, misses and evictions as csim.
+ *
+ * Authors: Theodore Bieber (tjbieber), James Honicker (jlhonicker)
+*/
+#ifndef CACHESIM_H
+#define CACHESIM_H
+
+#include "tracefile.h" // address_t
+
+// Sets per page of the sparse storage, and the dense size that turns it on by default
+#define SPARSE_PAGE_BITS 8
+#define SPARSE_MIN_BYTES (64LL << 20)
+
+// Contains the information about the cache
+typedef struct {
+	int sets; // -s
+	int blocks; // -b
+
+	int S; // 2^s
+	int B; // 2^b
+	int E; // -e
+
+	int hits;
+	int misses;
+	int evictions;
+
+	// worked out once by finishGeometry so the simulators don't redo it every access
+	unsigned long long setMask; // S - 1
+	int tagShift; // s + b
+	unsigned long long clock; // LRU clock, ticks once per access
+} cacheData;
+
+// Type definitions for the cache data structure
+typedef struct {
+	unsigned long long lastUsed; // clock of the last access, 0 while the line is empty
+	int valid;
+	address_t tag;
+	char *block;
+} cacheSetLine;
+
+typedef struct {
+	cacheSetLine *lines;
+} cacheSet;
+
+typedef struct {
+	cacheSetLine *allLines; // every set's lines, set i starts at allLines[i * E]
+
+	// sparse storage: sets are allocated a page at a time, the first time a page is touched
+	cacheSetLine **pages; // NULL for the dense storage above
+	int pageBits; // sets per page = 2^pageBits
+	int lines; // E
+} cache;
+// end of cache
+
+/* Every simulator (generic or specialized) has this signature
+ * cData is updated in place rather than passed and returned by value: the main loop would read
+ * the returned struct back with wider loads than the simulator's stores, and a store that can't
+ * be forwarded stalls each access until the previous one's set lookup has finished.
+*/
+typedef void (*simulateFunction)(cache theCache, cacheData *cData, address_t address);
+
+/* Build the cache, see cachesim.c
+ * Parameters:
+ *     sets: S, lines: E, blockSize: B
+ *     sparse: allocate the sets a page at a time, the first time they are used
+*/
+cache generateCache(long long sets, int lines, long long blockSize, int sparse);
+
+// Returns how many bytes the cache's sets take up
+unsigned long long cacheFootprint(cache theCache, long long sets);
+
+// Deallocates the memory used by the cache
+void freeCache(cache theCache, long long sets, int lines, long long blockSize);
+
+// The generic simulators, for dense and sparse storage
+void simulateCache(cache theCache, cacheData *cData, address_t address);
+void simulateSparseCache(cache theCache, cacheData *cData, address_t address);
+
+/* Picks the simulator for a number of lines per set and a storage, once at startup
+ * Parameters:
+ *     lines: E
+ *     sparse: whether the cache was generated with sparse storage
+ *     generic: always use the generic simulator (-G)
+ * return: a specialized simulator, or the generic one if there is none for lines
+*/
+simulateFunction pickSimulator(int lines, int sparse, int generic);
+
+// Fills in everything about the cache that follows from -s, -E and -b
+cacheData finishGeometry(cacheData data);
+
+#endif /* CACHESIM_H */
@@ -0,0 +1,606 @@
+/* Multi-core coherent cache simulation.
+ * Every core has a private set-associative LRU cache. Lines carry a MESI/MOESI state, and every
+ * miss or upgrade looks at the other cores' copies. On a snooping bus every other core looks the
+ * block up; with a directory (-D) each block has a sharer vector, kept exact by fills,
+ * invalidations and replacements, and only the cores in it are asked.
+ * Besides hits, misses and evictions per core, this counts coherence misses, invalidations,
+ * bus traffic, and invalidations caused by false sharing (the writer and the invalidated core
+ * touched different bytes of the block).
+ *
+ * Authors: Theodore Bieber (tjbieber), James Honicker (jlhonicker)
+*/
+#define _POSIX_C_SOURCE 200809L
+#include "cachelab.h"
+#include "coherence.h"
+#include "tracefile.h"
+#include "hashtable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+// Line states, in the order of stateNames
+enum { STATE_I, STATE_S, STATE_E, STATE_O, STATE_M };
+static const char stateNames[] = "ISEOM";
+
+// One line of a core's private cache
+typedef struct {
+	address_t tag;
+	unsigned long long lastUsed;
+	uint64_t touched; // which parts of the block this core accessed since it got the line
+	int state;
+	int invalidated; // went invalid because another core wrote the block
+} cohLine;
+
+// A core: its trace reader and its private cache
+typedef struct {
+	FILE *trace;
+	int binary;
+	int done;
+	unsigned long long recordNumber;
+
+	// the next record, read ahead so the interleaver can look at it
+	char op;
+	address_t address;
+	int size;
+	unsigned long long timestamp;
+
+	cohLine *lines; // set i is lines[i*E] .. lines[i*E + E - 1]
+	int hits;
+	int misses;
+	int evictions;
+	int coherenceMisses;
+	int invalidationsReceived;
+} cohCore;
+
+// Per-block coherence statistics, kept in a hashTable by block
+typedef struct {
+	address_t block;
+	unsigned int invalidations;
+	unsigned int falseSharing;
+	unsigned int coherenceMisses;
+} blockStats;
+
+// Interconnect statistics
+typedef struct {
+	unsigned long long busReads;
+	unsigned long long busReadExclusives;
+	unsigned long long busUpgrades;
+	unsigned long long writebacks;
+	unsigned long long cacheToCache;
+	unsigned long long invalidations;
+	unsigned long long falseSharing;
+	unsigned long long messages; // point to point messages, directory mode only
+	unsigned long long dataBytes;
+	unsigned long long lookups; // other cores' caches the directory sent a request to
+	unsigned long long peakDirectoryEntries;
+} busStats;
+
+// A directory entry: the cores holding a copy of a block (MAX_CORES fits in the bits)
+typedef struct {
+	uint64_t sharers;
+} dirEntry;
+
+// The whole simulated machine
+typedef struct {
+	coherenceConfig *config;
+	cohCore *cores;
+	int amtCores;
+	unsigned long long clock; // global LRU clock
+	int lastCore; // round-robin position
+	unsigned long long randomState;
+	busStats bus;
+	hashTable table; // blockStats
+	hashTable directory; // dirEntry by block, only the blocks some core holds (directory mode)
+} cohSystem;
+
+// function prototypes
+static int readCoreRecord(cohCore *core);
+static int pickCore(cohSystem *sys);
+static void accessBlock(cohSystem *sys, int coreIndex, int isWrite, address_t address, int size);
+static blockStats *getBlockStats(hashTable *table, address_t block);
+static void printReport(cohSystem *sys);
+static void freeSystem(cohSystem *sys);
+
+int simulateCoherence(coherenceConfig *config, char **traceFiles, int amtTraces) {
+	cohSystem sys;
+	int corecounter;
+	long long lines = (1LL << config->sets) * config->E;
+
+	memset(&sys, 0, sizeof(sys));
+	sys.config = config;
+	sys.amtCores = amtTraces;
+	sys.lastCore = -1;
+	sys.randomState = config->seed;
+	sys.cores = (cohCore *) calloc(amtTraces, sizeof(cohCore));
+	if(sys.cores == NULL) {
+		printf("Out of memory for the cores\n");
+		return 1;
+	}
+	sys.table = createHashTable(sizeof(blockStats), 1024, 0);
+	sys.directory = createHashTable(sizeof(dirEntry), config->directory ? 1024 : 16, 0);
+
+	for(corecounter = 0; corecounter < amtTraces; corecounter++) {
+		cohCore *core = &sys.cores[corecounter];
+
+		core->trace = fopen(traceFiles[corecounter], "r");
+		if(core->trace == NULL) {
+			printf("%s: No such file or directory\n", traceFiles[corecounter]);
+			freeSystem(&sys);
+			return 1;
+		}
+		core->binary = trace_is_binary(core->trace);
+		core->lines = (cohLine *) calloc(lines, sizeof(cohLine));
+		if(core->lines == NULL) {
+			printf("Out of memory for core %d's cache\n", corecounter);
+			freeSystem(&sys);
+			return 1;
+		}
+		core->done = !readCoreRecord(core);
+	}
+
+	// MAIN LOOP
+	int coreIndex;
+	while((coreIndex = pickCore(&sys)) >= 0) {
+		cohCore *core = &sys.cores[coreIndex];
+
+		if(core->op == 'L' || core->op == 'M') {
+			accessBlock(&sys, coreIndex, 0, core->address, core->size);
+		}
+		if(core->op == 'S' || core->op == 'M') {
+			accessBlock(&sys, coreIndex, 1, core->address, core->size);
+		}
+		core->done = !readCoreRecord(core);
+	}
+
+	printReport(&sys);
+	freeSystem(&sys);
+	return 0;
+}
+
+// Deallocates all memory and closes the trace files, including those of a half set up system
+static void freeSystem(cohSystem *sys) {
+	int corecounter;
+
+	for(corecounter = 0; corecounter < sys->amtCores; corecounter++) {
+		if(sys->cores[corecounter].trace != NULL) {
+			fclose(sys->cores[corecounter].trace);
+		}
+		free(sys->cores[corecounter].lines);
+	}
+	free(sys->cores);
+	freeHashTable(&sys->table);
+	freeHashTable(&sys->directory);
+}
+
+/* Reads the next data access of a core into the core's read-ahead fields
+ * Text records may end in an optional decimal timestamp (" L 10,4 1234") for the timestamp
+ * interleaving; records without one (and all binary records) use their position among the core's
+ * data accesses. Instruction fetches and lines that are not records (valgrind's own output) are
+ * skipped and don't count toward that position, in either format.
+ * return: 1 if a record was read, 0 at the end of the trace
+*/
+static int readCoreRecord(cohCore *core) {
+	char buf[256];
+
+	if(core->binary) {
+		uint64_t record;
+		do {
+			if(trace_read_binary(core->trace, &record, 1) != 1) {
+				return 0;
+			}
+			core->op = TRACE_OP(record);
+		} while(core->op == 'I');
+		core->timestamp = core->recordNumber++;
+		core->address = TRACE_ADDR(record);
+		core->size = TRACE_SIZE(record);
+		return 1;
+	}
+
+	while(fgets(buf, sizeof(buf), core->trace) != NULL) {
+		int fields = sscanf(buf, " %c %llx,%d %llu", &core->op, &core->address, &core->size,
+				&core->timestamp);
+		if(fields < 3 || core->op == 'I') {
+			continue;
+		}
+		if(fields == 3) {
+			core->timestamp = core->recordNumber;
+		}
+		core->recordNumber++;
+		return 1;
+	}
+	return 0;
+}
+
+/* Picks the core whose access goes next, according to the interleaving policy
+ * return: the core index, or -1 once every trace is finished
+*/
+static int pickCore(cohSystem *sys) {
+	int active[MAX_CORES];
+	int amtActive = 0;
+	int corecounter;
+
+	for(corecounter = 0; corecounter < sys->amtCores; corecounter++) {
+		if(!sys->cores[corecounter].done) {
+			active[amtActive++] = corecounter;
+		}
+	}
+	if(amtActive == 0) {
+		return -1;
+	}
+
+	switch(sys->config->interleave) {
+	case INTERLEAVE_TIMESTAMP: {
+		// smallest timestamp, ties go to the lower core
+		int best = active[0];
+		for(corecounter = 1; corecounter < amtActive; corecounter++) {
+			if(sys->cores[active[corecounter]].timestamp < sys->cores[best].timestamp) {
+				best = active[corecounter];
+			}
+		}
+		return best;
+	}
+	case INTERLEAVE_RANDOM: {
+		// splitmix64, so a seed always gives the same schedule
+		uint64_t z = hashMix(sys->randomState);
+		sys->randomState += 0x9e3779b97f4a7c15ULL;
+		return active[z % amtActive];
+	}
+	case INTERLEAVE_ROUND_ROBIN:
+	default:
+		// the next active core after the last one
+		for(corecounter = 0; corecounter < amtActive; corecounter++) {
+			if(active[corecounter] > sys->lastCore) {
+				break;
+			}
+		}
+		sys->lastCore = active[corecounter == amtActive ? 0 : corecounter];
+		return sys->lastCore;
+	}
+}
+
+/* Turns the bytes an access touches into a mask with one bit per 1/64th of the block
+ * (one bit per byte for blocks of up to 64 bytes)
+*/
+static uint64_t touchMask(cohSystem *sys, address_t address, int size) {
+	int blockSize = 1 << sys->config->blocks;
+	int granule = blockSize > 64 ? blockSize / 64 : 1;
+	int offset = address & (blockSize - 1);
+	int first = offset / granule;
+	int last = (offset + (size > 0 ? size : 1) - 1) / granule;
+	int maxBit = blockSize > 64 ? 63 : blockSize - 1;
+
+	if(last > maxBit) {
+		last = maxBit;
+	}
+	if(last - first >= 63) {
+		return ~0ULL;
+	}
+	return ((1ULL << (last - first + 1)) - 1) << first;
+}
+
+/* The cores other than coreIndex that may hold a block: the directory's sharers, or every core on a
+ * snooping bus
+*/
+static uint64_t otherHolders(cohSystem *sys, int coreIndex, address_t block) {
+	uint64_t holders;
+
+	if(sys->config->directory) {
+		dirEntry *entry = (dirEntry *) hashTableFind(&sys->directory, block);
+		holders = entry != NULL ? entry->sharers : 0;
+	} else {
+		holders = sys->amtCores == 64 ? ~0ULL : (1ULL << sys->amtCores) - 1;
+	}
+	return holders & ~(1ULL << coreIndex);
+}
+
+// Records in the directory whether a core holds a block (directory mode only)
+static void setSharer(cohSystem *sys, address_t block, int coreIndex, int holds) {
+	dirEntry *entry;
+
+	if(!sys->config->directory) {
+		return;
+	}
+	if(holds) {
+		entry = (dirEntry *) hashTableGet(&sys->directory, block);
+		entry->sharers |= 1ULL << coreIndex;
+		if(sys->directory.count > sys->bus.peakDirectoryEntries) {
+			sys->bus.peakDirectoryEntries = sys->directory.count;
+		}
+		return;
+	}
+	entry = (dirEntry *) hashTableFind(&sys->directory, block);
+	if(entry != NULL) {
+		entry->sharers &= ~(1ULL << coreIndex);
+		if(entry->sharers == 0) {
+			hashTableRemove(&sys->directory, block);
+		}
+	}
+}
+
+// Returns the valid line holding tag in the given set of a core, or NULL
+static cohLine *findLine(cohSystem *sys, cohCore *core, address_t set, address_t tag) {
+	int E = sys->config->E;
+	cohLine *lines = &core->lines[set * E];
+	int linecounter;
+
+	for(linecounter = 0; linecounter < E; linecounter++) {
+		if(lines[linecounter].state != STATE_I && lines[linecounter].tag == tag) {
+			return &lines[linecounter];
+		}
+	}
+	return NULL;
+}
+
+/* Finds a line for a new block in a core's set: an invalid line if there is one, otherwise the
+ * least recently used line, which is evicted (and written back if it is dirty)
+*/
+static cohLine *allocateLine(cohSystem *sys, cohCore *core, address_t set) {
+	int E = sys->config->E;
+	cohLine *lines = &core->lines[set * E];
+	cohLine *victim = &lines[0];
+	int linecounter;
+
+	for(linecounter = 0; linecounter < E; linecounter++) {
+		if(lines[linecounter].state == STATE_I) {
+			return &lines[linecounter];
+		}
+		if(lines[linecounter].lastUsed < victim->lastUsed) {
+			victim = &lines[linecounter];
+		}
+	}
+
+	core->evictions++;
+	setSharer(sys, (victim->tag << sys->config->sets) | set, core - sys->cores, 0);
+	if(victim->state == STATE_M || victim->state == STATE_O) {
+		sys->bus.writebacks++;
+		sys->bus.dataBytes += 1 << sys->config->blocks;
+		sys->bus.messages++;
+	} else if(sys->config->directory) {
+		// clean replacement hint, so the directory can drop the sharer
+		sys->bus.messages++;
+	}
+	return victim;
+}
+
+/* Invalidates every other core's copy of a block because coreIndex is writing it
+ * Parameters:
+ *     mask: the part of the block the writer is touching, to spot false sharing
+*/
+static void invalidateOthers(cohSystem *sys, int coreIndex, address_t set, address_t tag,
+		address_t block, uint64_t mask) {
+	uint64_t holders = otherHolders(sys, coreIndex, block);
+	int corecounter;
+
+	for(corecounter = 0; corecounter < sys->amtCores; corecounter++) {
+		cohLine *other;
+		if(!(holders >> corecounter & 1)) {
+			continue;
+		}
+		other = findLine(sys, &sys->cores[corecounter], set, tag);
+		if(other == NULL) {
+			continue;
+		}
+
+		blockStats *stats = getBlockStats(&sys->table, block);
+		stats->invalidations++;
+		sys->bus.invalidations++;
+		if((other->touched & mask) == 0) {
+			stats->falseSharing++;
+			sys->bus.falseSharing++;
+		}
+		if(sys->config->directory) {
+			sys->bus.messages += 2; // invalidation and its acknowledgement
+		}
+
+		other->state = STATE_I;
+		other->invalidated = 1;
+		other->touched = 0;
+		sys->cores[corecounter].invalidationsReceived++;
+		setSharer(sys, block, corecounter, 0);
+	}
+}
+
+/* Simulates one read or write by a core and keeps every cache coherent
+ * Parameters:
+ *     coreIndex: the core doing the access
+ *     isWrite: 0 for a read, 1 for a write
+ *     address, size: the access
+*/
+static void accessBlock(cohSystem *sys, int coreIndex, int isWrite, address_t address, int size) {
+	coherenceConfig *config = sys->config;
+	cohCore *core = &sys->cores[coreIndex];
+	address_t block = address >> config->blocks;
+	address_t set = block & ((1ULL << config->sets) - 1);
+	address_t tag = block >> config->sets;
+	uint64_t mask = touchMask(sys, address, size);
+	int blockSize = 1 << config->blocks;
+	cohLine *line = findLine(sys, core, set, tag);
+	int oldState = line ? line->state : STATE_I;
+	int coherenceMiss = 0;
+	int corecounter;
+
+	sys->clock++;
+
+	if(line != NULL) {
+		core->hits++;
+		if(isWrite && (line->state == STATE_S || line->state == STATE_O)) {
+			// we have the data but not the permission
+			sys->bus.busUpgrades++;
+			sys->bus.messages++;
+			invalidateOthers(sys, coreIndex, set, tag, block, mask);
+		}
+		if(isWrite) {
+			line->state = STATE_M;
+		}
+		line->lastUsed = sys->clock;
+		line->touched |= mask;
+	} else {
+		core->misses++;
+
+		// a miss on a block another core took away from us is a coherence miss
+		int linecounter;
+		for(linecounter = 0; linecounter < config->E; linecounter++) {
+			cohLine *stale = &core->lines[set * config->E + linecounter];
+			if(stale->state == STATE_I && stale->invalidated && stale->tag == tag) {
+				coherenceMiss = 1;
+				stale->invalidated = 0;
+			}
+		}
+		if(coherenceMiss) {
+			core->coherenceMisses++;
+			getBlockStats(&sys->table, block)->coherenceMisses++;
+		}
+
+		// look at the other copies (a snoop, or the directory's sharer list)
+		uint64_t holders = otherHolders(sys, coreIndex, block);
+		int othersHaveCopy = 0;
+		int ownerSupplies = 0;
+		for(corecounter = 0; corecounter < sys->amtCores; corecounter++) {
+			cohLine *other;
+			if(!(holders >> corecounter & 1)) {
+				continue;
+			}
+			if(config->directory) {
+				sys->bus.lookups++;
+			}
+			other = findLine(sys, &sys->cores[corecounter], set, tag);
+			if(other == NULL) {
+				continue;
+			}
+			othersHaveCopy = 1;
+			if(other->state == STATE_M || other->state == STATE_O || other->state == STATE_E) {
+				ownerSupplies = 1;
+			}
+			if(isWrite) {
+				continue; // invalidated below
+			}
+			if(other->state == STATE_M) {
+				if(config->protocol == PROTOCOL_MOESI) {
+					other->state = STATE_O; // keep the dirty data, share it
+				} else {
+					other->state = STATE_S; // MESI has to write it back first
+					sys->bus.writebacks++;
+					sys->bus.dataBytes += blockSize;
+					sys->bus.messages++;
+				}
+			} else if(other->state == STATE_E) {
+				other->state = STATE_S;
+			}
+		}
+
+		sys->bus.messages++; // the request
+		if(ownerSupplies) {
+			sys->bus.cacheToCache++;
+			if(config->directory) {
+				sys->bus.messages++; // forwarded to the owner
+			}
+		}
+		sys->bus.messages++; // the data reply
+		sys->bus.dataBytes += blockSize;
+
+		if(isWrite) {
+			sys->bus.busReadExclusives++;
+			invalidateOthers(sys, coreIndex, set, tag, block, mask);
+		} else {
+			sys->bus.busReads++;
+		}
+
+		line = allocateLine(sys, core, set);
+		setSharer(sys, block, coreIndex, 1);
+		line->tag = tag;
+		line->state = isWrite ? STATE_M : (othersHaveCopy ? STATE_S : STATE_E);
+		line->lastUsed = sys->clock;
+		line->touched = mask;
+		line->invalidated = 0;
+	}
+
+	if(config->verbose) {
+		printf("core %d %c %llx,%d %s%s %c->%c\n", coreIndex, isWrite ? 'W' : 'R', address, size,
+				oldState != STATE_I ? "hit" : "miss", coherenceMiss ? " coherence" : "",
+				stateNames[oldState], stateNames[line->state]);
+	}
+}
+
+// Finds (or adds) the statistics entry of a block
+static blockStats *getBlockStats(hashTable *table, address_t block) {
+	blockStats *stats = (blockStats *) hashTableGet(table, block);
+
+	stats->block = block;
+	return stats;
+}
+
+// Sorts blocks by false-sharing invalidations, then all invalidations, most first
+static int compareBlockStats(const void *a, const void *b) {
+	const blockStats *x = (const blockStats *) a;
+	const blockStats *y = (const blockStats *) b;
+
+	if(x->falseSharing != y->falseSharing) {
+		return x->falseSharing < y->falseSharing ? 1 : -1;
+	}
+	if(x->invalidations != y->invalidations) {
+		return x->invalidations < y->invalidations ? 1 : -1;
+	}
+	return x->block < y->block ? -1 : (x->block > y->block);
+}
+
+// Prints the per-core, interconnect and hot block results, then the usual summary
+static void printReport(cohSystem *sys) {
+	coherenceConfig *config = sys->config;
+	int hits = 0, misses = 0, evictions = 0, coherenceMisses = 0;
+	int corecounter;
+	blockStats *hot = (blockStats *) malloc(sizeof(blockStats) * (sys->table.count + 1));
+	size_t entrycounter, amtBlocks, amtHot = 0;
+
+	for(corecounter = 0; corecounter < sys->amtCores; corecounter++) {
+		cohCore *core = &sys->cores[corecounter];
+		printf("core %d: hits:%d misses:%d evictions:%d coherence_misses:%d invalidations:%d\n",
+				corecounter, core->hits, core->misses, core->evictions, core->coherenceMisses,
+				core->invalidationsReceived);
+		hits += core->hits;
+		misses += core->misses;
+		evictions += core->evictions;
+		coherenceMisses += core->coherenceMisses;
+	}
+
+	printf("protocol:%s interconnect:%s\n", config->protocol == PROTOCOL_MOESI ? "MOESI" : "MESI",
+			config->directory ? "directory" : "snooping-bus");
+	printf("bus_reads:%llu bus_read_exclusives:%llu bus_upgrades:%llu writebacks:%llu "
+			"cache_to_cache:%llu\n", sys->bus.busReads, sys->bus.busReadExclusives,
+			sys->bus.busUpgrades, sys->bus.writebacks, sys->bus.cacheToCache);
+	printf("invalidations:%llu false_sharing_invalidations:%llu coherence_misses:%d\n",
+			sys->bus.invalidations, sys->bus.falseSharing, coherenceMisses);
+	if(config->directory) {
+		printf("directory_messages:%llu data_bytes:%llu\n", sys->bus.messages, sys->bus.dataBytes);
+		printf("directory_entries:%llu peak_directory_entries:%llu sharer_lookups:%llu\n",
+				sys->directory.count, sys->bus.peakDirectoryEntries, sys->bus.lookups);
+	} else {
+		// every bus transaction is broadcast and looked up by all of the other cores
+		unsigned long long transactions = sys->bus.busReads + sys->bus.busReadExclusives +
+			sys->bus.busUpgrades + sys->bus.writebacks;
+		printf("bus_transactions:%llu snoop_lookups:%llu data_bytes:%llu\n", transactions,
+				transactions * (sys->amtCores - 1), sys->bus.dataBytes);
+	}
+
+	// copy out the blocks that saw invalidations, then sort them
+	amtBlocks = hashTableCopy(&sys->table, hot);
+	for(entrycounter = 0; entrycounter < amtBlocks; entrycounter++) {
+		if(hot[entrycounter].invalidations) {
+			hot[amtHot++] = hot[entrycounter];
+		}
+	}
+	qsort(hot, amtHot, sizeof(blockStats), compareBlockStats);
+	if(amtHot > 0 && config->hotBlocks > 0) {
+		printf("hot blocks (by false sharing):\n");
+	}
+	for(entrycounter = 0; entrycounter < amtHot && (int) entrycounter < config->hotBlocks;
+			entrycounter++) {
+		blockStats *stats = &hot[entrycounter];
+		printf("  0x%llx invalidations:%u false_sharing:%u coherence_misses:%u\n",
+				stats->block << config->blocks, stats->invalidations, stats->falseSharing,
+				stats->coherenceMisses);
+	}
+	free(hot);
+
+	printSummary(hits, misses, evictions);
+}
@@ -0,0 +1,44 @@
+/* Multi-core coherent cache simulation.
+ * Each trace file is the access stream of one core. The streams are interleaved into a single
+ * global order and run against private per-core caches kept coherent with MESI or MOESI.
+ *
+ * Authors: Theodore Bieber (tjbieber), James Honicker (jlhonicker)
+*/
+#ifndef COHERENCE_H
+#define COHERENCE_H
+
+// Most cores a coherence run can have (sizes the trace file list and the per-step core arrays)
+#define MAX_CORES 64
+
+// Coherence protocols
+typedef enum {
+	PROTOCOL_MESI,
+	PROTOCOL_MOESI
+} protocol_t;
+
+// How the per-core traces are merged into one global order
+typedef enum {
+	INTERLEAVE_ROUND_ROBIN, // one access from each core in turn
+	INTERLEAVE_TIMESTAMP,   // smallest timestamp first (see readCoreRecord in coherence.c)
+	INTERLEAVE_RANDOM       // a seeded random core each step
+} interleave_t;
+
+// Everything a coherence run needs to know
+typedef struct {
+	int sets; // -s
+	int E;    // -E
+	int blocks; // -b
+	protocol_t protocol; // -C
+	interleave_t interleave; // -O
+	unsigned long long seed; // -R
+	int directory; // -D, a directory with per-block sharer vectors instead of a snooping bus
+	int hotBlocks; // -H, false-sharing blocks to report
+	int verbose; // -v
+} coherenceConfig;
+
+/* Runs the coherence simulation over amtTraces trace files, one per core, and prints its report.
+ * return: 0 on success, 1 if a trace could not be opened or the caches could not be allocated
+*/
+int simulateCoherence(coherenceConfig *config, char **traceFiles, int amtTraces);
+
+#endif /* COHERENCE_H */
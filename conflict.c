@@ -0,0 +1,286 @@
+/* Conflict miss mitigation analysis.
+ * The baseline and mitigated caches share one implementation: every way has its own index
+ * function (the same one for modulo and XOR indexing, a different one per way when skewed), and
+ * the replacement candidate is the least recently used of the lines the block can go in. A hit in
+ * the victim cache counts as a hit and swaps the block back with the line it displaces.
+ *
+ * Authors: Theodore Bieber (tjbieber), James Honicker (jlhonicker)
+*/
+#include "conflict.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Multiplier for the per-way hashes, each way uses an odd multiple of it
+#define SKEW_MULTIPLIER 0x9e3779b97f4a7c15ULL
+
+static const char *indexModeNames[] = { "modulo", "xor", "skewed" };
+
+// Sets up one organization, all lines empty
+static void createConflictCache(conflictCache *c, int sets, int E, indexMode_t mode,
+		int victimEntries) {
+	unsigned long long lines = (1ULL << sets) * E;
+
+	c->mode = mode;
+	c->sets = sets;
+	c->E = E;
+	c->blocks = (unsigned long long *) calloc(lines, sizeof(unsigned long long));
+	c->lastUsed = (unsigned long long *) calloc(lines, sizeof(unsigned long long));
+	c->victimEntries = victimEntries;
+	c->victimBlocks = (unsigned long long *) calloc(victimEntries + 1, sizeof(unsigned long long));
+	c->victimLastUsed = (unsigned long long *) calloc(victimEntries + 1, sizeof(unsigned long long));
+	c->clock = 0;
+	c->hits = 0;
+	c->misses = 0;
+	c->victimHits = 0;
+}
+
+// Returns the set a block maps to in one way
+static inline unsigned long long indexOf(conflictCache *c, unsigned long long block, int way) {
+	unsigned long long mask = (1ULL << c->sets) - 1;
+
+	switch(c->mode) {
+	case INDEX_XOR:
+		return (block ^ (block >> c->sets)) & mask;
+	case INDEX_SKEW:
+		if(c->sets == 0) {
+			return 0;
+		}
+		// multiplicative hash, keeping the top bits, with a different multiplier per way
+		return ((block ^ (block >> c->sets)) * (SKEW_MULTIPLIER * (2 * way + 1))) >> (64 - c->sets);
+	case INDEX_MODULO:
+	default:
+		return block & mask;
+	}
+}
+
+/* Looks a block up in one organization and fills it in on a miss
+ * return: 1 on a hit (in the cache or its victim cache), 0 on a miss
+*/
+static int accessConflictCache(conflictCache *c, unsigned long long block) {
+	unsigned long long S = 1ULL << c->sets;
+	unsigned long long victimPosition = 0;
+	unsigned long long evictedBlock, evictedUsed;
+	int waycounter, victimcounter, victimSlot = -1;
+
+	c->clock++;
+	for(waycounter = 0; waycounter < c->E; waycounter++) {
+		unsigned long long position = waycounter * S + indexOf(c, block, waycounter);
+		if(c->lastUsed[position] && c->blocks[position] == block) {
+			c->lastUsed[position] = c->clock;
+			c->hits++;
+			return 1;
+		}
+		// the least recently used candidate (empty lines are 0, so they go first)
+		if(waycounter == 0 || c->lastUsed[position] < c->lastUsed[victimPosition]) {
+			victimPosition = position;
+		}
+	}
+
+	// not in the cache itself, the line it replaces may go to the victim cache
+	evictedBlock = c->blocks[victimPosition];
+	evictedUsed = c->lastUsed[victimPosition];
+	c->blocks[victimPosition] = block;
+	c->lastUsed[victimPosition] = c->clock;
+
+	if(c->victimEntries == 0) {
+		c->misses++;
+		return 0;
+	}
+
+	for(victimcounter = 0; victimcounter < c->victimEntries; victimcounter++) {
+		if(c->victimLastUsed[victimcounter] && c->victimBlocks[victimcounter] == block) {
+			victimSlot = victimcounter;
+			break;
+		}
+	}
+	if(victimSlot >= 0) {
+		// swap: the displaced line takes the block's victim entry
+		c->victimHits++;
+		c->hits++;
+		c->victimBlocks[victimSlot] = evictedBlock;
+		c->victimLastUsed[victimSlot] = evictedUsed ? c->clock : 0;
+		return 1;
+	}
+
+	c->misses++;
+	if(evictedUsed) {
+		// the displaced line replaces the least recently used victim entry
+		victimSlot = 0;
+		for(victimcounter = 1; victimcounter < c->victimEntries; victimcounter++) {
+			if(c->victimLastUsed[victimcounter] < c->victimLastUsed[victimSlot]) {
+				victimSlot = victimcounter;
+			}
+		}
+		c->victimBlocks[victimSlot] = evictedBlock;
+		c->victimLastUsed[victimSlot] = c->clock;
+	}
+	return 0;
+}
+
+// Takes a node out of the LRU list
+static void unlinkNode(fullyAssociative *fa, long long node) {
+	if(fa->prev[node] >= 0) {
+		fa->next[fa->prev[node]] = fa->next[node];
+	} else {
+		fa->head = fa->next[node];
+	}
+	if(fa->next[node] >= 0) {
+		fa->prev[fa->next[node]] = fa->prev[node];
+	} else {
+		fa->tail = fa->prev[node];
+	}
+}
+
+// Puts a node at the most recently used end of the LRU list
+static void pushNode(fullyAssociative *fa, long long node) {
+	fa->prev[node] = -1;
+	fa->next[node] = fa->head;
+	if(fa->head >= 0) {
+		fa->prev[fa->head] = node;
+	}
+	fa->head = node;
+	if(fa->tail < 0) {
+		fa->tail = node;
+	}
+}
+
+// Looks a block up in the fully associative cache, filling it in on a miss
+static void accessFullyAssociative(fullyAssociative *fa, unsigned long long block) {
+	long long *found = (long long *) hashTableFind(&fa->index, block);
+	long long node;
+
+	if(found != NULL) {
+		unlinkNode(fa, *found);
+		pushNode(fa, *found);
+		return;
+	}
+
+	fa->misses++;
+	if(fa->used < fa->lines) {
+		node = fa->used++;
+	} else {
+		// evict the least recently used block
+		node = fa->tail;
+		unlinkNode(fa, node);
+		hashTableRemove(&fa->index, fa->blocks[node]);
+	}
+	fa->blocks[node] = block;
+	*(long long *) hashTableGet(&fa->index, block) = node;
+	pushNode(fa, node);
+}
+
+// Sets up a fully associative cache of the given number of lines, all empty
+static void createFullyAssociative(fullyAssociative *fa, unsigned long long lines) {
+	fa->lines = lines;
+	fa->used = 0;
+	fa->misses = 0;
+	fa->head = -1;
+	fa->tail = -1;
+	fa->blocks = (unsigned long long *) calloc(fa->lines, sizeof(unsigned long long));
+	fa->prev = (long long *) calloc(fa->lines, sizeof(long long));
+	fa->next = (long long *) calloc(fa->lines, sizeof(long long));
+	fa->index = createHashTable(sizeof(long long), fa->lines * 2, 0);
+}
+
+static void freeFullyAssociative(fullyAssociative *fa) {
+	free(fa->blocks);
+	free(fa->prev);
+	free(fa->next);
+	freeHashTable(&fa->index);
+}
+
+conflictAnalysis createConflictAnalysis(int sets, int E, int blocks, indexMode_t mode,
+		int victimEntries) {
+	conflictAnalysis analysis;
+
+	memset(&analysis, 0, sizeof(analysis));
+	analysis.blocks = blocks;
+	createConflictCache(&analysis.baseline, sets, E, INDEX_MODULO, 0);
+	createFullyAssociative(&analysis.full, (1ULL << sets) * E);
+	if(mode != INDEX_MODULO) {
+		createConflictCache(&analysis.indexed, sets, E, mode, 0);
+	}
+	if(victimEntries > 0) {
+		createConflictCache(&analysis.victim, sets, E, INDEX_MODULO, victimEntries);
+		createFullyAssociative(&analysis.fullVictim, (1ULL << sets) * E + victimEntries);
+	}
+	return analysis;
+}
+
+void conflictAccess(conflictAnalysis *analysis, unsigned long long address) {
+	unsigned long long block = address >> analysis->blocks;
+
+	accessConflictCache(&analysis->baseline, block);
+	accessFullyAssociative(&analysis->full, block);
+	if(analysis->indexed.blocks != NULL) {
+		accessConflictCache(&analysis->indexed, block);
+	}
+	if(analysis->victim.blocks != NULL) {
+		accessConflictCache(&analysis->victim, block);
+		accessFullyAssociative(&analysis->fullVictim, block);
+	}
+}
+
+/* Prints one cache's misses and conflict misses, measured against a fully associative cache of
+ * the same capacity
+ * return: its conflict misses, 0 when it took fewer misses than the fully associative cache
+*/
+static unsigned long long printConflictCache(conflictCache *c, fullyAssociative *full,
+		int *anomalies) {
+	unsigned long long conflicts = c->misses > full->misses ? c->misses - full->misses : 0;
+
+	printf(" misses:%llu conflict_misses:%llu", c->misses, conflicts);
+	if(c->misses < full->misses) {
+		printf(" below_fully_associative:%llu", full->misses - c->misses);
+		*anomalies = 1;
+	}
+	if(c->victimEntries > 0) {
+		printf(" victim_hits:%llu", c->victimHits);
+	}
+	printf("\n");
+	return conflicts;
+}
+
+void printConflictAnalysis(conflictAnalysis *analysis) {
+	conflictCache *base = &analysis->baseline;
+	unsigned long long baseConflicts, conflicts;
+	int anomalies = 0;
+
+	printf("conflict analysis (s=%d, E=%d): fully associative misses:%llu\n", base->sets, base->E,
+		analysis->full.misses);
+	printf("  baseline (modulo index)");
+	baseConflicts = printConflictCache(base, &analysis->full, &anomalies);
+
+	if(analysis->indexed.blocks != NULL) {
+		printf("  %s index", indexModeNames[analysis->indexed.mode]);
+		conflicts = printConflictCache(&analysis->indexed, &analysis->full, &anomalies);
+		printf("    conflict misses removed:%lld\n", (long long) baseConflicts - (long long) conflicts);
+	}
+	if(analysis->victim.blocks != NULL) {
+		printf("  %d-entry victim cache", analysis->victim.victimEntries);
+		conflicts = printConflictCache(&analysis->victim, &analysis->fullVictim, &anomalies);
+		printf("    fully associative with the victim lines (%llu lines) misses:%llu"
+			" capacity misses removed:%lld\n", analysis->fullVictim.lines, analysis->fullVictim.misses,
+			(long long) analysis->full.misses - (long long) analysis->fullVictim.misses);
+		printf("    conflict misses removed:%lld\n", (long long) baseConflicts - (long long) conflicts);
+	}
+	if(anomalies) {
+		printf("  below_fully_associative: misses under the fully associative cache's (LRU isn't"
+			" optimal), counted as 0 conflict misses\n");
+	}
+}
+
+void freeConflictAnalysis(conflictAnalysis *analysis) {
+	conflictCache *caches[3] = { &analysis->baseline, &analysis->indexed, &analysis->victim };
+	int cachecounter;
+
+	for(cachecounter = 0; cachecounter < 3; cachecounter++) {
+		free(caches[cachecounter]->blocks);
+		free(caches[cachecounter]->lastUsed);
+		free(caches[cachecounter]->victimBlocks);
+		free(caches[cachecounter]->victimLastUsed);
+	}
+	freeFullyAssociative(&analysis->full);
+	freeFullyAssociative(&analysis->fullVictim);
+}
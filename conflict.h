@@ -0,0 +1,79 @@
+/* Conflict miss mitigation analysis.
+ * Runs the data accesses through the plain cache (modulo set index), the same cache with each
+ * requested mitigation on its own (XOR or skewed indexing, a victim cache), and a fully associative
+ * LRU cache of the same capacity as each. Misses the fully associative cache doesn't take are
+ * conflict misses, so comparing a mitigated cache with the plain one shows how many conflict misses
+ * that mitigation removed. A victim cache also adds capacity, so its extra lines are reported as
+ * capacity misses removed on their own.
+ * LRU is not an optimal policy, so a set associative cache can take fewer misses than the fully
+ * associative one (most often with few sets). Conflict misses are then counted as 0 and the
+ * difference is reported separately.
+ *
+ * Authors: Theodore Bieber (tjbieber), James Honicker (jlhonicker)
+*/
+#ifndef CONFLICT_H
+#define CONFLICT_H
+
+#include "hashtable.h"
+
+// How a block picks its line(s)
+typedef enum {
+	INDEX_MODULO, // the usual middle address bits
+	INDEX_XOR,    // middle bits XOR the bits above them, the same set in every way
+	INDEX_SKEW    // a different hash per way (skewed-associative)
+} indexMode_t;
+
+// One organization of S sets x E ways, plus an optional victim cache
+typedef struct {
+	indexMode_t mode;
+	int sets; // s
+	int E;
+	unsigned long long *blocks; // E arrays of S blocks, way w is blocks[w * S ..]
+	unsigned long long *lastUsed; // same layout, 0 means empty
+	int victimEntries;
+	unsigned long long *victimBlocks;
+	unsigned long long *victimLastUsed;
+	unsigned long long clock;
+	unsigned long long hits;
+	unsigned long long misses;
+	unsigned long long victimHits;
+} conflictCache;
+
+// Fully associative LRU cache with a hash index, for the compulsory + capacity misses
+typedef struct {
+	unsigned long long lines; // S * E, plus the victim entries for the victim cache's
+	unsigned long long used;
+	unsigned long long *blocks; // per node
+	long long *prev, *next; // LRU list, head is most recent
+	long long head, tail;
+	hashTable index; // block -> node (long long)
+	unsigned long long misses;
+} fullyAssociative;
+
+typedef struct {
+	conflictCache baseline;
+	conflictCache indexed; // xor or skewed indexing, only used when mode isn't INDEX_MODULO
+	conflictCache victim; // modulo indexing plus a victim cache, only used with victim entries
+	fullyAssociative full; // same capacity as baseline and indexed
+	fullyAssociative fullVictim; // same capacity as victim
+	int blocks; // b
+} conflictAnalysis;
+
+/* Builds the analysis for a cache of 2^sets sets of E lines with 2^blocks byte blocks
+ * Parameters:
+ *     mode: set indexing to compare with modulo indexing, INDEX_MODULO for none
+ *     victimEntries: size of the victim cache to compare with no victim cache, 0 for none
+*/
+conflictAnalysis createConflictAnalysis(int sets, int E, int blocks, indexMode_t mode,
+		int victimEntries);
+
+// Runs one data access through all of the caches
+void conflictAccess(conflictAnalysis *analysis, unsigned long long address);
+
+// Prints the comparison
+void printConflictAnalysis(conflictAnalysis *analysis);
+
+// Deallocates the analysis
+void freeConflictAnalysis(conflictAnalysis *analysis);
+
+#endif /* CONFLICT_H */
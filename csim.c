@@ -1,123 +1,358 @@
 /* Cache Simulator. 
- * The cache is stored as a series of structs, cache has cacheSet s, the cacheSet has cacheLine s
- * and the cacheLine has a cache's line information.
- *
+ * Reads the trace and runs it through the cache (cachesim.c) and whichever analyses were asked for.
  *
  * Authors: Theodore Bieber (tjbieber), James Honicker (jlhonicker)
 */
+#define _POSIX_C_SOURCE 200809L
 #include "cachelab.h"
+#include "tracefile.h"
+#include "cachesim.h"
+#include "coherence.h"
+#include "profile.h"
+#include "tlb.h"
+#include "conflict.h"
+#include "window.h"
+#include "footprint.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <getopt.h>
+#include <time.h>
 
-// Contains the information about the cache
-typedef struct {
-	int sets; // -s
-	int blocks; // -b
-
-	int S; // 2^s
-	int B; // 2^b
-	int E; // -e
+// Number of trace records parsed at a time
+#define TRACE_CHUNK 65536
 
-	int hits;
-	int misses;
-	int evictions;
-} cacheData;
+// Records whose sets are prefetched together, and the cache size that turns it on by default
+#define PREFETCH_WINDOW 32
+#define PREFETCH_MIN_BYTES (4 << 20)
 
-typedef unsigned long long int address_t; // this would be a pain to type out more than once
-
-// Type definitions for the cache data structure
+// One access read from the trace file
 typedef struct {
-	int lastUsed;
-	int valid;
-	address_t tag;
-	char *block;
-} cacheSetLine;
-
-typedef struct {
-	cacheSetLine *lines;
-} cacheSet;
-
-typedef struct {
-	cacheSet *sets;
-} cache;
-// end of cache
+	address_t address;
+	int size;
+	char op;
+} traceRecord;
 
 int verbose; // -v option flag
 
+// What happens to the instruction fetch (I) records
+typedef enum {
+	ICACHE_OFF,     // ignored, the default
+	ICACHE_SPLIT,   // a separate L1I with its own geometry (-I)
+	ICACHE_UNIFIED  // fetched through the data cache (-U)
+} icacheMode_t;
+
 // function prototypes
 void printHelp(char *argv[]);
-cache generateCache(long long sets, int lines, long long blockSize);
-void freeCache(cache theCache, long long sets, int lines, long long blockSize);
-int getEmptyLine(cacheSet set, cacheData data);
-int findEvictee(cacheSet set, cacheData cData, int *usedLines);
-cacheData simulateCache(cache theCache, cacheData cData, address_t address);
+void prefetchSets(cache theCache, cacheData cData, traceRecord *records, int amtRecords);
+int readTraceChunk(FILE *trace, int binary, traceRecord *records, int maxRecords);
+double now(void);
 
 int main(int argc, char *argv[]) {
 
-	int AMT_ARGS = 9;
-	int TRACEFILE_NAME_MAX_SIZE = 32;
-
 	cacheData cData;
 	cData.hits = 0;
 	cData.misses = 0;
 	cData.evictions = 0;
-
-	// name of the tracefile -t
-	char *traceFileName = malloc(TRACEFILE_NAME_MAX_SIZE);
-
-	if(argc < AMT_ARGS) {
-		printHelp(argv);
-
-	} else if(argc == AMT_ARGS) {
-		// parse argv with no optional flags
-		// allows for the -s -E -b and -t commands to be in any order
-		int i = 2;
-		for(i = 2; i < argc; i+=2) {
-			if(!strncmp(argv[i-1], "-s", 3)) {
-				cData.sets = atoi(argv[i]);
-			} else if(!strncmp(argv[i-1], "-E", 3)) {
-				cData.E = atoi(argv[i]);
-			} else if(!strncmp(argv[i-1], "-b", 3)) {
-				cData.blocks = atoi(argv[i]);
-			} else if(!strncmp(argv[i-1], "-t", 3)) {
-				strcpy(traceFileName, argv[i]);
+	cData.sets = -1;
+	cData.E = -1;
+	cData.blocks = -1;
+
+	// name of the tracefile(s) -t, more than one means one trace per core
+	char *traceFiles[MAX_CORES];
+	int amtTraces = 0;
+	int timing = 0; // -T option flag
+	int forceGeneric = 0; // -G option flag
+	int prefetchWindow = -1; // -w, -1 means decide from the cache size
+	int sparse = -1; // -m, -1 means decide from the cache size
+	int coherence = 0; // -C given
+	icacheMode_t icacheMode = ICACHE_OFF;
+	cacheData iData; // the L1I when split, the instruction share of the cache when unified
+	memset(&iData, 0, sizeof(iData));
+	int profileTop = 0; // -p, instructions to report
+	char *profileBinary = NULL; // -x
+	address_t profileOffset = 0; // -x binary@offset
+	int useTlb = 0; // -L or -P given
+	int tlbGeometry[4] = {64, 4, 1536, 12}; // -L dTLB entries,ways,STLB entries,ways
+	int pageBits = 12; // -P
+	int injectWalks = 0; // -W
+	int walkLatency = WALK_LATENCY; // -Y <miss>[,<hit>]
+	int walkHitLatency = WALK_HIT_LATENCY;
+	int analyzeConflicts = 0; // -V or -X given
+	int victimEntries = 0; // -V
+	indexMode_t indexMode = INDEX_MODULO; // -X
+	unsigned long long windowSize = 0; // -K, 0 means no windowed statistics
+	char *windowFile = NULL; // -o, stderr if not given, so the rows stay out of the report
+	double phaseThreshold = 0; // -F, 0 means no phase detection
+	int footprintTop = -1; // -A, hottest blocks to report, -1 means no footprint analysis
+	int regionBits = 20; // -A K,<region bits>
+	coherenceConfig cohConfig;
+	int opt;
+	// flags only a single-core run uses, and flags only a coherence run uses, to reject the rest
+	const char *singleCoreFlags = "TUWGwmIpxLPYVXKoFA";
+	const char *coherenceFlags = "ORDH";
+	int singleCoreFlag = 0, coherenceFlag = 0; // the last one given of each
+
+	memset(&cohConfig, 0, sizeof(cohConfig));
+	cohConfig.hotBlocks = 10;
+
+	// parse argv, the flags can come in any order
+	while((opt = getopt(argc, argv, "hvTUWGw:m:s:E:b:t:I:p:x:L:P:Y:V:X:K:o:F:A:C:O:R:DH:")) != -1) {
+		if(strchr(singleCoreFlags, opt)) {
+			singleCoreFlag = opt;
+		} else if(strchr(coherenceFlags, opt)) {
+			coherenceFlag = opt;
+		}
+		switch(opt) {
+		case 's':
+			cData.sets = atoi(optarg);
+			break;
+		case 'E':
+			cData.E = atoi(optarg);
+			break;
+		case 'b':
+			cData.blocks = atoi(optarg);
+			break;
+		case 't':
+			if(amtTraces == MAX_CORES) {
+				printf("At most %d trace files are supported\n", MAX_CORES);
+				return 1;
+			}
+			traceFiles[amtTraces++] = optarg;
+			break;
+		case 'L':
+			if(sscanf(optarg, "%d,%d,%d,%d", &tlbGeometry[0], &tlbGeometry[1], &tlbGeometry[2],
+					&tlbGeometry[3]) != 4) {
+				printHelp(argv);
+			}
+			useTlb = 1;
+			break;
+		case 'P':
+			if(!strcmp(optarg, "4k") || !strcmp(optarg, "4K")) {
+				pageBits = 12;
+			} else if(!strcmp(optarg, "2m") || !strcmp(optarg, "2M")) {
+				pageBits = 21;
+			} else if(!strcmp(optarg, "1g") || !strcmp(optarg, "1G")) {
+				pageBits = 30;
+			} else {
+				printHelp(argv);
+			}
+			useTlb = 1;
+			break;
+		case 'W':
+			injectWalks = 1;
+			useTlb = 1;
+			break;
+		case 'Y':
+			if(sscanf(optarg, "%d,%d", &walkLatency, &walkHitLatency) < 1 || walkLatency < 0 ||
+					walkHitLatency < 0) {
+				printHelp(argv);
+			}
+			useTlb = 1;
+			break;
+		case 'V':
+			victimEntries = atoi(optarg);
+			if(victimEntries < 0) {
+				printHelp(argv);
+			}
+			analyzeConflicts = 1;
+			break;
+		case 'X':
+			if(!strcmp(optarg, "xor")) {
+				indexMode = INDEX_XOR;
+			} else if(!strcmp(optarg, "skew")) {
+				indexMode = INDEX_SKEW;
+			} else {
+				printHelp(argv);
+			}
+			analyzeConflicts = 1;
+			break;
+		case 'K':
+			windowSize = strtoull(optarg, NULL, 0);
+			break;
+		case 'o':
+			windowFile = optarg;
+			break;
+		case 'F':
+			phaseThreshold = atof(optarg);
+			if(phaseThreshold <= 0 || phaseThreshold >= 1) {
+				printHelp(argv);
+			}
+			break;
+		case 'A':
+			if(sscanf(optarg, "%d,%d", &footprintTop, &regionBits) < 1 || footprintTop < 0 ||
+					regionBits < 0 || regionBits > 47) {
+				printHelp(argv);
 			}
+			break;
+		case 'C':
+			coherence = 1;
+			if(!strcmp(optarg, "mesi")) {
+				cohConfig.protocol = PROTOCOL_MESI;
+			} else if(!strcmp(optarg, "moesi")) {
+				cohConfig.protocol = PROTOCOL_MOESI;
+			} else {
+				printHelp(argv);
+			}
+			break;
+		case 'O':
+			if(!strcmp(optarg, "rr")) {
+				cohConfig.interleave = INTERLEAVE_ROUND_ROBIN;
+			} else if(!strcmp(optarg, "ts")) {
+				cohConfig.interleave = INTERLEAVE_TIMESTAMP;
+			} else if(!strcmp(optarg, "random")) {
+				cohConfig.interleave = INTERLEAVE_RANDOM;
+			} else {
+				printHelp(argv);
+			}
+			break;
+		case 'R':
+			cohConfig.seed = strtoull(optarg, NULL, 0);
+			break;
+		case 'D':
+			cohConfig.directory = 1;
+			break;
+		case 'H':
+			cohConfig.hotBlocks = atoi(optarg);
+			break;
+		case 'I':
+			if(sscanf(optarg, "%d,%d,%d", &iData.sets, &iData.E, &iData.blocks) != 3 ||
+					iData.sets < 0 || iData.E <= 0 || iData.blocks < 0) {
+				printHelp(argv);
+			}
+			icacheMode = ICACHE_SPLIT;
+			break;
+		case 'U':
+			icacheMode = ICACHE_UNIFIED;
+			break;
+		case 'p':
+			profileTop = atoi(optarg);
+			break;
+		case 'x': {
+			// binary[@load offset]
+			char *at = strrchr(optarg, '@');
+			if(at != NULL) {
+				*at = '\0';
+				profileOffset = strtoull(at + 1, NULL, 0);
+			}
+			profileBinary = optarg;
+			break;
 		}
-
-	} else if(argc > AMT_ARGS) {
-		// parse argv with optional flags
-		// allows for the -s -E -b and -t commands to be in any order (after the optional commands)
-		// meaning that the optional commands MUST come first if you want the program to work
-		if(!strncmp(argv[1], "-h", 3)) {
-			printHelp(argv);
-		} else if(!strncmp(argv[1], "-v", 3)) {
-			// verbose mode
+		case 'v':
 			verbose = 1;
+			break;
+		case 'T':
+			timing = 1;
+			break;
+		case 'G':
+			forceGeneric = 1;
+			break;
+		case 'w':
+			prefetchWindow = atoi(optarg);
+			break;
+		case 'm':
+			if(!strcmp(optarg, "dense")) {
+				sparse = 0;
+			} else if(!strcmp(optarg, "sparse")) {
+				sparse = 1;
+			} else {
+				printHelp(argv);
+			}
+			break;
+		case 'h':
+		default:
+			printHelp(argv);
 		}
+	}
 
-		int i = 3;
-		for(i = 3; i < argc; i+=2) {
-			if(!strncmp(argv[i-1], "-s", 3)) {
-				cData.sets = atoi(argv[i]);
-			} else if(!strncmp(argv[i-1], "-E", 3)) {
-				cData.E = atoi(argv[i]);
-			} else if(!strncmp(argv[i-1], "-b", 3)) {
-				cData.blocks = atoi(argv[i]);
-			} else if(!strncmp(argv[i-1], "-t", 3)) {
-				strcpy(traceFileName, argv[i]);
-			}
+	if(cData.sets < 0 || cData.E <= 0 || cData.blocks < 0 || amtTraces == 0) {
+		printHelp(argv);
+	}
+	if(windowSize == 0 && (windowFile != NULL || phaseThreshold > 0)) {
+		printf("-%c needs -K <num>, the window size\n", phaseThreshold > 0 ? 'F' : 'o');
+		return 1;
+	}
 
+	// More than one trace (or -C) means a multi-core coherence run
+	if(coherence || amtTraces > 1) {
+		if(singleCoreFlag) {
+			printf("-%c is not supported in a multi-core coherence run (-C or several -t)\n",
+				singleCoreFlag);
+			return 1;
 		}
+		cohConfig.sets = cData.sets;
+		cohConfig.E = cData.E;
+		cohConfig.blocks = cData.blocks;
+		cohConfig.verbose = verbose;
+		return simulateCoherence(&cohConfig, traceFiles, amtTraces);
+	}
+	if(coherenceFlag) {
+		printf("-%c only applies to a multi-core coherence run (-C or several -t)\n", coherenceFlag);
+		return 1;
 	}
+	char *traceFileName = traceFiles[0];
 
 	// Finally, assign S and B
-	cData.S = 1<<(cData.sets);
-	cData.B = 1<<(cData.blocks);
+	cData = finishGeometry(cData);
 	
-	cache myCache = generateCache(cData.S, cData.E, cData.B);
+	// Huge caches only get storage for the sets the trace touches
+	if(sparse < 0) {
+		sparse = (long long) cData.S * cData.E * sizeof(cacheSetLine) >= SPARSE_MIN_BYTES;
+	}
+	cache myCache = generateCache(cData.S, cData.E, cData.B, sparse);
+	// Once the cache's lines stop fitting in the host's caches, every lookup is a host cache miss,
+	// so look ahead and prefetch the sets of the next records while simulating the current ones
+	if(prefetchWindow < 0) {
+		prefetchWindow = (long long) cData.S * cData.E * sizeof(cacheSetLine) >= PREFETCH_MIN_BYTES ?
+			PREFETCH_WINDOW : 0;
+	}
+	simulateFunction simulate = pickSimulator(cData.E, sparse, forceGeneric);
+	cache iCache; // only allocated for a split L1I
+	simulateFunction simulateI = simulate;
+	if(icacheMode == ICACHE_SPLIT) {
+		iData = finishGeometry(iData);
+		iCache = generateCache(iData.S, iData.E, iData.B, sparse);
+		simulateI = pickSimulator(iData.E, sparse, forceGeneric);
+	} else {
+		iCache = myCache;
+	}
+
+	tlb myTlb;
+	if(useTlb) {
+		myTlb = createTlb(tlbGeometry[0], tlbGeometry[1], tlbGeometry[2], tlbGeometry[3], pageBits);
+		if(myTlb.l1.entries == 0) {
+			printf("TLB entries must be a multiple of the ways\n");
+			return 1;
+		}
+		myTlb.walkLatency = walkLatency;
+		myTlb.walkHitLatency = walkHitLatency;
+	}
+
+	conflictAnalysis conflicts;
+	if(analyzeConflicts) {
+		conflicts = createConflictAnalysis(cData.sets, cData.E, cData.blocks, indexMode,
+			victimEntries);
+	}
 
-	// Open the file for reading, line by line
+	footprintAnalysis footprint;
+	if(footprintTop >= 0) {
+		footprint = createFootprint(cData.blocks, footprintTop, regionBits);
+	}
+
+	windowStats windows;
+	FILE *windowOut = stderr;
+	cacheData noCache; // the windows count the L1I too when it is split
+	memset(&noCache, 0, sizeof(noCache));
+	cacheData *windowI = icacheMode == ICACHE_SPLIT ? &iData : &noCache;
+	if(windowSize > 0) {
+		if(windowFile != NULL && (windowOut = fopen(windowFile, "w")) == NULL) {
+			printf("%s: Cannot open for writing\n", windowFile);
+			return 1;
+		}
+		windows = createWindowStats(windowOut, windowSize, cData.blocks, phaseThreshold);
+	}
+
+	// Open the file for reading
 	FILE *trace = fopen(traceFileName, "r");
 
 	if(trace == NULL) {
@@ -126,31 +361,134 @@ int main(int argc, char *argv[]) {
 	}
 
 	// MAIN LOOP
-	char op;
-	address_t address;
-	int size;
+	// The trace is read a chunk of records at a time, so the time spent parsing
+	// and the time spent simulating can be measured separately for -T
+	traceRecord *records = (traceRecord *) malloc(sizeof(traceRecord) * TRACE_CHUNK);
+	int binary = trace_is_binary(trace);
+	int amtRecords;
+	unsigned long long accesses = 0;
+	address_t lastInstruction = 0; // the most recent I record, which issued the data accesses after it
+	missProfile profile;
+	if(profileTop > 0) {
+		profile = createProfile();
+	}
+	double parseTime = 0;
+	double simulateTime = 0;
+	double startTime = now();
+	double chunkTime = startTime;
+
+	while((amtRecords = readTraceChunk(trace, binary, records, TRACE_CHUNK)) > 0) {
+		double parsedTime = now();
+		parseTime += parsedTime - chunkTime;
+
+		int recordcounter;
+		if(prefetchWindow > 0) {
+			prefetchSets(myCache, cData, records,
+				prefetchWindow < amtRecords ? prefetchWindow : amtRecords);
+		}
+		for(recordcounter = 0; recordcounter < amtRecords; recordcounter++) {
+			// at the start of each window, prefetch the window after it
+			if(prefetchWindow > 0 && recordcounter % prefetchWindow == 0 &&
+					recordcounter + prefetchWindow < amtRecords) {
+				int ahead = amtRecords - (recordcounter + prefetchWindow);
+				prefetchSets(myCache, cData, &records[recordcounter + prefetchWindow],
+					prefetchWindow < ahead ? prefetchWindow : ahead);
+			}
+
+			char op = records[recordcounter].op;
+			address_t address = records[recordcounter].address;
+			int size = records[recordcounter].size;
+
+			// Pick the cache the access goes to
+			cache targetCache = myCache;
+			cacheData *target = &cData;
+			simulateFunction targetSimulate = simulate;
+			if(op == 'I') {
+				lastInstruction = address;
+				if(icacheMode == ICACHE_OFF) { // Ignore these
+					continue;
+				} else if(icacheMode == ICACHE_SPLIT) {
+					targetCache = iCache;
+					target = &iData;
+					targetSimulate = simulateI;
+				}
+			}
+			accesses++;
+
+			// Translate data addresses first, a page walk may go through the data cache
+			tlbResult_t translation = TLB_L1_HIT;
+			if(useTlb && op != 'I') {
+				address_t walkAddresses[MAX_WALK_LEVELS];
+				translation = translate(&myTlb, address, walkAddresses);
+				if(translation == TLB_WALK && injectWalks) {
+					// The walk takes up cache space, but its hits, misses and evictions
+					// are the TLB's, not the program's
+					int walkcounter;
+					int programHits = cData.hits;
+					int programMisses = cData.misses;
+					int programEvictions = cData.evictions;
+					for(walkcounter = 0; walkcounter < myTlb.walkLevels; walkcounter++) {
+						simulate(myCache, &cData, walkAddresses[walkcounter]);
+					}
+					myTlb.walkCacheHits += cData.hits - programHits;
+					myTlb.walkCacheMisses += cData.misses - programMisses;
+					myTlb.walkCacheEvictions += cData.evictions - programEvictions;
+					cData.hits = programHits;
+					cData.misses = programMisses;
+					cData.evictions = programEvictions;
+				}
+			}
 
-	// filter the trace file line by line, store info into variables
-	while(fscanf(trace, " %c %llx,%d", &op, &address, &size) == 3) {
-		if(op != 'I') { // Ignore these
 			// The "before" data
-			int hits = cData.hits;
-			int misses = cData.misses;
-			int evictions = cData.evictions;
+			int hits = target->hits;
+			int misses = target->misses;
+			int evictions = target->evictions;
 			
-			cData = simulateCache(myCache, cData, address);
+			targetSimulate(targetCache, target, address);
 			if(op == 'M') {
-				cData = simulateCache(myCache, cData, address);
+				targetSimulate(targetCache, target, address);
 			}
 			// turn the numbers into booleans
-			hits = cData.hits - hits;
-			misses = cData.misses - misses;
-			evictions = cData.evictions - evictions;
+			hits = target->hits - hits;
+			misses = target->misses - misses;
+			evictions = target->evictions - evictions;
+
+			// keep the instruction share of a unified cache separately
+			if(op == 'I' && icacheMode == ICACHE_UNIFIED) {
+				iData.hits += hits;
+				iData.misses += misses;
+				iData.evictions += evictions;
+			}
+			if(profileTop > 0 && op != 'I') {
+				recordProfile(&profile, lastInstruction, hits, misses, evictions);
+			}
+			if(analyzeConflicts && op != 'I') {
+				conflictAccess(&conflicts, address);
+				if(op == 'M') {
+					conflictAccess(&conflicts, address);
+				}
+			}
+			if(footprintTop >= 0 && op != 'I') {
+				footprintAccess(&footprint, address);
+				if(op == 'M') {
+					footprintAccess(&footprint, address);
+				}
+			}
+			if(windowSize > 0) {
+				windowAccess(&windows, address);
+				windowCheck(&windows, accesses, cData.hits + windowI->hits,
+					cData.misses + windowI->misses, cData.evictions + windowI->evictions);
+			}
 		
 			if(verbose) {
 				printf("%c %llx,%d", op, address, size);
 				
 				int counter;
+				if(translation == TLB_STLB_HIT) {
+					printf(" dtlb-miss");
+				} else if(translation == TLB_WALK) {
+					printf(" walk");
+				}
 				if(misses) {
 					printf(" miss");
 				}
@@ -163,202 +501,203 @@ int main(int argc, char *argv[]) {
 				printf("\n");
 			}
 		}
-		
+
+		chunkTime = now();
+		simulateTime += chunkTime - parsedTime;
 	}
 
 	// Deallocate all memory and close file(s)
-	free(traceFileName);
+	free(records);
+	unsigned long long cacheBytes = cacheFootprint(myCache, cData.S);
 	freeCache(myCache, cData.S, cData.E, cData.B);
+	if(icacheMode == ICACHE_SPLIT) {
+		freeCache(iCache, iData.S, iData.E, iData.B);
+	}
 	fclose(trace);
 
+	if(useTlb) {
+		printTlb(&myTlb);
+		freeTlb(&myTlb);
+	}
+	if(profileTop > 0) {
+		printProfile(&profile, profileTop, profileBinary, profileOffset);
+		freeProfile(&profile);
+	}
+	if(analyzeConflicts) {
+		printConflictAnalysis(&conflicts);
+		freeConflictAnalysis(&conflicts);
+	}
+	if(footprintTop >= 0) {
+		printFootprint(&footprint);
+		freeFootprint(&footprint);
+	}
+	if(windowSize > 0) {
+		finishWindowStats(&windows, accesses, cData.hits + windowI->hits,
+			cData.misses + windowI->misses, cData.evictions + windowI->evictions);
+		if(windowOut != stderr) {
+			fclose(windowOut);
+		}
+	}
+
+	// The summary is always the data (or unified) cache, the instruction side comes first
+	if(icacheMode == ICACHE_SPLIT) {
+		printf("L1I (s=%d, E=%d, b=%d) hits:%d misses:%d evictions:%d\n", iData.sets, iData.E,
+			iData.blocks, iData.hits, iData.misses, iData.evictions);
+		printf("L1D (s=%d, E=%d, b=%d) ", cData.sets, cData.E, cData.blocks);
+	} else if(icacheMode == ICACHE_UNIFIED) {
+		printf("unified instruction hits:%d misses:%d evictions:%d\n", iData.hits, iData.misses,
+			iData.evictions);
+		printf("unified data hits:%d misses:%d evictions:%d\n", cData.hits - iData.hits,
+			cData.misses - iData.misses, cData.evictions - iData.evictions);
+		printf("unified (s=%d, E=%d, b=%d) ", cData.sets, cData.E, cData.blocks);
+	}
 	printSummary(cData.hits, cData.misses, cData.evictions);
+
+	if(timing) {
+		// machine readable, on stderr so it never mixes with the summary
+		fprintf(stderr, "accesses:%llu parse_s:%.6f simulate_s:%.6f total_s:%.6f cache_bytes:%llu\n",
+			accesses, parseTime, simulateTime, now() - startTime, cacheBytes);
+	}
     return 0;
 }
 
-/* Simulates the cache, updating the summary data for each call.
- * Uses the below functions (other than printHelp), and is called in the main loop
+/* Prefetches the sets that a window of upcoming records will look up.
+ * Only the host cache is affected, so the lookups themselves still happen in trace order and give
+ * exactly the same results; this just lets the host fetch many sets from memory at once instead of
+ * waiting for each one in turn.
  * Parameters:
- *     theCache: the cache struct that we are using as a cache
- *     cData: the information about the cache
- *     address: the address that we are trying to access.
- *              this is the only parameter that changes between each run of this function
- * return: a new cacheData with updated summary data (hits, misses, evictions)
+ *     records, amtRecords: the window of records
 */
-cacheData simulateCache(cache theCache, cacheData cData, address_t address) {
-	int linecounter; // line index
-	int cacheFull = 1;
+void prefetchSets(cache theCache, cacheData cData, traceRecord *records, int amtRecords) {
+	size_t setBytes = sizeof(cacheSetLine) * cData.E;
+	int recordcounter;
 
-	int lines = cData.E; 
-	int previousHits = cData.hits; // so we can check the before and after values
+	for(recordcounter = 0; recordcounter < amtRecords; recordcounter++) {
+		unsigned long long setcounter = (records[recordcounter].address >> cData.blocks) & cData.setMask;
+		char *set;
+		size_t offset;
 
-	int tagSize = (64 - (cData.sets + cData.blocks));
-	address_t cacheLineTag = address >> (cData.sets + cData.blocks);
-	unsigned long long tempaddr = address << (tagSize); 
-	unsigned long long setcounter = tempaddr >> (tagSize + cData.blocks);
-
-	cacheSet set = theCache.sets[setcounter];
-
-	for(linecounter = 0; linecounter < lines; linecounter++) {
-		cacheSetLine line = set.lines[linecounter];
-
-		if(line.valid) {
-			if(line.tag == cacheLineTag) {
-				line.lastUsed++;
-				cData.hits++;
-				set.lines[linecounter] = line;
+		if(records[recordcounter].op == 'I') {
+			continue;
+		}
+		if(theCache.pages != NULL) {
+			// only sets that already have storage can be prefetched
+			cacheSetLine *page = theCache.pages[setcounter >> theCache.pageBits];
+			if(page == NULL) {
+				continue;
 			}
-		} else if(!line.valid && cacheFull) {
-			// update flag because we know there's an empty line
-			cacheFull = 0;
+			set = (char *) (page + (setcounter & ((1ULL << theCache.pageBits) - 1)) * cData.E);
+		} else {
+			set = (char *) (theCache.allLines + setcounter * cData.E);
+		}
+		for(offset = 0; offset < setBytes; offset += 64) {
+			__builtin_prefetch(set + offset, 1, 0);
 		}
 	}
+}
 
-	if(previousHits == cData.hits) {
-		cData.misses++;
-	} else {
-		return cData;
+/* Reads up to maxRecords accesses from either kind of trace file
+ * Parameters:
+ *     trace: the open trace file
+ *     binary: whether the trace is in the binary format
+ *     records: filled in with the accesses
+ *     maxRecords: the size of records
+ * return: the number of records read, 0 at the end of the trace
+*/
+int readTraceChunk(FILE *trace, int binary, traceRecord *records, int maxRecords) {
+	int amtRecords = 0;
+
+	if(binary) {
+		uint64_t raw[1024];
+		while(amtRecords < maxRecords) {
+			int want = maxRecords - amtRecords < 1024 ? maxRecords - amtRecords : 1024;
+			int got = trace_read_binary(trace, raw, want);
+			int counter;
+			for(counter = 0; counter < got; counter++) {
+				records[amtRecords].op = TRACE_OP(raw[counter]);
+				records[amtRecords].address = TRACE_ADDR(raw[counter]);
+				records[amtRecords].size = TRACE_SIZE(raw[counter]);
+				amtRecords++;
+			}
+			if(got < want) {
+				break;
+			}
+		}
+		return amtRecords;
 	}
 
-	// Since we missed, we need to find a spot to take, either evict or find empty space
-
-	int *usedLines = (int*)malloc(sizeof(int)*2); // index 0 is minUsed, 1 is maxUsed
-	// Find the least recently used line
-	int minUsedIndex = findEvictee(set, cData, usedLines);
-
-	if(cacheFull) {
-		cData.evictions++;
-		// Evict the least recently used line
-		set.lines[minUsedIndex].tag = cacheLineTag;
-		set.lines[minUsedIndex].lastUsed = usedLines[1] + 1;
-	} else { // there is an empty spot, so we just need to find it
-		int emptycounter = getEmptyLine(set, cData);
-		set.lines[emptycounter].tag = cacheLineTag;
-		set.lines[emptycounter].valid = 1;
-		set.lines[emptycounter].lastUsed = usedLines[1] + 1;
+	while(amtRecords < maxRecords && fscanf(trace, " %c %llx,%d", &records[amtRecords].op,
+			&records[amtRecords].address, &records[amtRecords].size) == 3) {
+		amtRecords++;
 	}
-	free(usedLines);
-	return cData;
+	return amtRecords;
+}
 
+// Returns a monotonic timestamp in seconds
+double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
 }
 
 // Prints out the help message for this program
 void printHelp(char *argv[]) {
-	printf("Usage: %s [-hv] -s <num> -E <num> -b <num> -t <file>\n", argv[0]);
+	printf("Usage: %s [-hvTUG] [-w <num>] [-m <dense|sparse>] [-I <s,E,b>] [-p <num> [-x <binary[@offset]>]]\n"
+		"            [-L <e,w,e,w>] [-P <4k|2m|1g>] [-W] [-Y <m[,h]>] [-V <num>] [-X <xor|skew>]\n"
+		"            [-K <num> [-o <file>] [-F <num>]] [-A <num>[,<bits>]] -s <num> -E <num> -b <num> -t <file>\n", argv[0]);
+	printf("       %s [-hv] [-C <mesi|moesi>] [-O <rr|ts|random>] [-R <seed>] [-D] [-H <num>]\n"
+		"            -s <num> -E <num> -b <num> -t <core 0 file> -t <core 1 file> ...\n", argv[0]);
     printf("Options:\n");
     printf("  -h         Print this help message.\n");
     printf("  -v         Optional verbose flag.\n");
+    printf("  -T         Print parse and simulate times to stderr.\n");
+    printf("  -G         Always use the generic simulator, not one specialized for E.\n");
+    printf("  -m <name>  Set storage: dense, or sparse to allocate sets when first used.\n");
+    printf("             (default sparse once a dense cache would take %lld MB)\n", SPARSE_MIN_BYTES >> 20);
+    printf("  -w <num>   Prefetch the sets of <num> records ahead, 0 turns it off.\n");
+    printf("             (default %d once the cache takes %d MB, otherwise off)\n", PREFETCH_WINDOW,
+        PREFETCH_MIN_BYTES >> 20);
     printf("  -s <num>   Number of set index bits.\n");
     printf("  -E <num>   Number of lines per set.\n");
     printf("  -b <num>   Number of block offset bits.\n");
-    printf("  -t <file>  Trace file.\n");
+    printf("  -t <file>  Trace file. Give one per core for a coherence run.\n");
+    printf("  -I <s,E,b> Simulate the I records in a separate L1I of this geometry.\n");
+    printf("  -U         Simulate the I records in the data cache (a unified cache).\n");
+    printf("  -p <num>   Print the <num> instructions whose data accesses miss the most.\n");
+    printf("  -x <file>  Symbolize -p with addr2line on this binary (file@offset for PIE).\n");
+    printf("  -L <list>  Put a TLB in front of the cache: dTLB entries,ways,STLB entries,ways.\n");
+    printf("             (default 64,4,1536,12)\n");
+    printf("  -P <size>  TLB page size, 4k, 2m or 1g (default 4k).\n");
+    printf("  -W         Send page walk references through the data cache (their hits and\n");
+    printf("             misses are reported with the TLB, not in the summary).\n");
+    printf("  -Y <m[,h]> Cycles per page walk reference, for the walk cost (default %d). With -W,\n",
+        WALK_LATENCY);
+    printf("             <m> is per reference that misses the cache and <h> per hit (default %d).\n",
+        WALK_HIT_LATENCY);
+    printf("  -V <num>   Report conflict misses with a <num>-entry victim cache added.\n");
+    printf("  -X <name>  Report conflict misses with xor or skewed set indexing.\n");
+    printf("  -K <num>   Write hits, misses, evictions and miss rate every <num> accesses as CSV.\n");
+    printf("  -o <file>  Write the -K rows to this file (default stderr).\n");
+    printf("  -F <num>   Label phases in the -K rows, a new phase starts when the working set\n");
+    printf("             signature changes by more than this fraction (0-1, e.g. 0.5).\n");
+    printf("  -A <num>   Estimate the distinct blocks over time and report the <num> hottest\n");
+    printf("             blocks and densest regions. -A <num>,<bits> sets the region size to\n");
+    printf("             2^<bits> bytes (default 20). Fixed-memory sketches, with error bounds.\n");
+    printf("  -C <name>  Coherence protocol for the per-core caches (default mesi).\n");
+    printf("  -O <name>  Interleave per-core traces round-robin, by timestamp or randomly.\n");
+    printf("  -R <seed>  Seed for the random interleaving.\n");
+    printf("  -D         Use a directory with a sharer vector per block instead of a snooping\n");
+    printf("             bus, so only the cores holding a block are sent requests.\n");
+    printf("  -H <num>   Number of false-sharing hot blocks to report (default 10).\n");
     printf("\nExamples:\n");
     printf("  %s -s 4 -E 1 -b 4 -t traces/yi.trace\n", argv[0]);
     printf("  %s -v -s 8 -E 2 -b 4 -t traces/yi.trace\n", argv[0]);
+    printf("  %s -I 6,8,6 -s 6 -E 8 -b 6 -t traces/trans.trace\n", argv[0]);
+    printf("  %s -p 10 -x tracegen -s 5 -E 1 -b 5 -t traces/trans.trace\n", argv[0]);
+    printf("  %s -P 2m -W -s 10 -E 8 -b 6 -t traces/long.trace\n", argv[0]);
+    printf("  %s -V 8 -X skew -s 5 -E 1 -b 5 -t traces/trans.trace\n", argv[0]);
+    printf("  %s -K 10000 -F 0.5 -o phases.csv -s 8 -E 4 -b 6 -t traces/long.trace\n", argv[0]);
+    printf("  %s -A 10,12 -s 8 -E 4 -b 6 -t traces/long.trace\n", argv[0]);
+    printf("  %s -C moesi -O random -R 1 -s 6 -E 4 -b 6 -t core0.trace -t core1.trace\n", argv[0]);
     exit(0);
 }
-
-
-/* Build the cache according to the specifications.
- * Allocated the space using malloc
- * From the cacheData: sets = S, lines = E, blockSize = B
- * returns the cache.
- * Note: we don't ever actually use blockSize, but I'm putting it there because
- *     if we were actually creating a real cache it would be needed.
-*/
-cache generateCache(long long sets, int lines, long long blockSize) {
-	cache generatedCache;
-	cacheSet set;
-	cacheSetLine line;
-
-	// allocate the space for the cache's sets
-	generatedCache.sets = (cacheSet *) malloc(sizeof(cacheSet) * sets);
-	
-	// allocate the space for all of the sets' lines
-	int setcounter; // set index
-	int linecounter; // line index
-	for(setcounter = 0; setcounter < sets; setcounter++) {
-		set.lines = (cacheSetLine *) malloc(sizeof(cacheSetLine) * lines);
-		generatedCache.sets[setcounter] = set;
-
-		for(linecounter = 0; linecounter < lines; linecounter++) {
-			line.lastUsed = 0;
-			line.valid = 0;
-			line.tag = 0;
-			set.lines[linecounter] = line;
-		}
-	}
-
-	return generatedCache;
-}
-
-/* Deallocates the memory used by the cache.
- * Note: we don't ever actually use blockSize, but I'm putting it there because
- *     if we were actually creating a real cache it would be needed.
-*/
-void freeCache(cache theCache, long long sets, int lines, long long blockSize) {
-	int setcounter;
-	for(setcounter = 0; setcounter < sets; setcounter++) {
-		cacheSet set = theCache.sets[setcounter];
-		if(set.lines != NULL) {
-			free(set.lines); 
-		}
-	}
-	if(theCache.sets != NULL) {
-		free(theCache.sets);
-	}
-}
-
-/* Finds an empty line in the given set by checking the valid bit
- * If for some reason there are no empty lines, it returns -1
- * Parameters:
- * 	   set: the set you are looking for an empty line in
- *     data: the information about the cache
- * return: the index of the line that is free
- 		-1 indicates that there were no free lines
-*/
-int getEmptyLine(cacheSet set, cacheData data) {
-	int lines = data.E;
-	int index;
-	cacheSetLine line;
-
-	for(index = 0; index < lines; index++) {
-		line = set.lines[index];
-		if(line.valid == 0) {
-			return index;
-		}
-	}
-	return -1;
-}
-
-/* Finds the index of the least recently used line with a simple search
- * Parameters:
- *     set: the set you are evicting from
- *     cData: the information about the cache
- *     usedLines: a small array that is given minUsed and maxUsed as a side effect
- * return: the index of the line being evicted
-*/
-int findEvictee(cacheSet set, cacheData cData, int *usedLines) {
-	int lines = cData.E;
-	int maxUsed = set.lines[0].lastUsed;
-	int minUsed = set.lines[0].lastUsed;
-	int minUsedIndex = 0;
-
-	cacheSetLine line;
-	int linecounter;
-
-	for(linecounter = 1; linecounter < lines; linecounter++) {
-		line = set.lines[linecounter];
-
-		if(minUsed > line.lastUsed) {
-			minUsedIndex = linecounter;
-			minUsed = line.lastUsed;
-		}
-
-		if(maxUsed < line.lastUsed) {
-			maxUsed = line.lastUsed;
-		}
-	}
-	usedLines[0] = minUsed;
-	usedLines[1] = maxUsed;
-	return minUsedIndex;
-}
\ No newline at end of file
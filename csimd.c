@@ -0,0 +1,781 @@
+/*
+ * csimd.c - Long-lived cache simulation server
+ *
+ * Sweeps that run csim once per (geometry, trace) pair spend most of
+ * their time starting processes and parsing the same traces again.
+ * csimd listens on a Unix domain socket instead, runs the jobs it is
+ * sent on a pool of worker threads, and keeps parsed traces in memory
+ * (up to -c megabytes, least recently used first out) so later jobs on
+ * the same trace skip the parse. A cached trace is reused only while
+ * the file's inode, size and modification time are unchanged.
+ *
+ * Each connection is read by a thread of its own, which hands every sim
+ * request to the pool and waits for its reply, so -j bounds the jobs
+ * running at once but not the number of clients, and idle clients never
+ * hold a worker. The simulation itself is csim's (cachesim.c).
+ *
+ * The protocol is line based. Each connection may send any number of
+ * requests, each of which gets exactly one reply line:
+ *
+ *     sim s=<s> E=<E> b=<b> trace=<path>
+ *     sim s=<s> E=<E> b=<b> batch
+ *         <trace records, one per line, in the text trace format>
+ *     end
+ *     stats
+ *     shutdown
+ *
+ * A sim reply is "ok hits:<n> misses:<n> evictions:<n> accesses:<n>
+ * cached:<0|1> sim_s:<seconds>", the same counts csim prints for the
+ * trace (I records are ignored, M records access twice). Anything that
+ * goes wrong is reported as "error <message>" and the connection stays
+ * usable. The trace path is opened by the server, so relative paths are
+ * relative to the directory csimd was started in.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "tracefile.h"
+#include "cachesim.h"
+
+/* Socket used when -S is not given */
+#define DEFAULT_SOCKET ".csimd.sock"
+
+/* Default limit on the memory taken by cached traces, in megabytes */
+#define DEFAULT_CACHE_MB 1024
+
+/* Longest request line */
+#define MAX_LINE 4096
+
+/* Jobs waiting for a worker, and the listen() backlog */
+#define QUEUE_SIZE 64
+
+/* Largest cache simulated, in lines */
+#define MAX_LINES (1ULL << 26)
+
+/* One parsed trace, data accesses only, packed as in tracefile.h */
+typedef struct trace_entry {
+    char *path;
+    dev_t dev;                 /* identify the file the records came from */
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    uint64_t *records;
+    size_t count;
+    int refs;                  /* jobs using the records right now */
+    int loading;               /* a job is still parsing the file */
+    int error;                 /* errno of a failed parse */
+    unsigned long long last_used;
+    struct trace_entry *next;
+} trace_entry_t;
+
+/* Results of one job */
+typedef struct {
+    unsigned long long hits, misses, evictions, accesses;
+} sim_result_t;
+
+/* One sim request, run by a worker while its connection waits */
+typedef struct {
+    int s, E, b;
+    const char *path;          /* trace=<path>, or NULL for a batch */
+    uint64_t *records;         /* the batch */
+    size_t count;
+    char reply[MAX_LINE];
+    int done;
+    pthread_cond_t finished;   /* signalled with queue_lock once done is set */
+} job_t;
+
+/* Trace cache, guarded by cache_lock */
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t trace_loaded = PTHREAD_COND_INITIALIZER;
+static trace_entry_t *traces = NULL;
+static size_t trace_bytes = 0;
+static size_t cache_limit = (size_t)DEFAULT_CACHE_MB << 20;
+static unsigned long long cache_clock = 0;
+static unsigned long long jobs_run = 0, trace_hits = 0, trace_loads = 0;
+
+/* Queue of jobs, guarded by queue_lock */
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t queue_space = PTHREAD_COND_INITIALIZER;
+static job_t *queue[QUEUE_SIZE];
+static int queue_head = 0, queue_count = 0;
+static int pool_stopping = 0;  /* set once no connection can send a job */
+
+/* Open connections, guarded by conn_lock */
+static pthread_mutex_t conn_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t conn_closed = PTHREAD_COND_INITIALIZER;
+static int *conns = NULL;
+static int conn_count = 0, conn_capacity = 0;
+
+/* Set by SIGINT/SIGTERM or a shutdown request */
+static volatile sig_atomic_t stopping = 0;
+static int listen_fd = -1;
+
+/* now - Monotonic timestamp in seconds */
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * append_record - Add a data access to a growing record array. I
+ *     records are dropped here, so the simulator never sees them.
+ */
+static void append_record(uint64_t **records, size_t *count, size_t *capacity,
+                          char op, unsigned long long addr, int size)
+{
+    if (op != 'L' && op != 'S' && op != 'M')
+        return;
+    if (*count == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 4096;
+        *records = realloc(*records, *capacity * sizeof(uint64_t));
+        if (*records == NULL) {
+            fprintf(stderr, "csimd: out of memory\n");
+            exit(1);
+        }
+    }
+    (*records)[(*count)++] = TRACE_PACK(op, size, addr);
+}
+
+/*
+ * load_trace - Parse a whole trace file (text or binary). Returns 0 on
+ *     success, -1 if it can't be read.
+ */
+static int load_trace(const char *path, uint64_t **records, size_t *count)
+{
+    FILE *fp = fopen(path, "r");
+    size_t capacity = 0;
+
+    *records = NULL;
+    *count = 0;
+    if (fp == NULL)
+        return -1;
+
+    if (trace_is_binary(fp)) {
+        uint64_t raw[1024];
+        size_t got, k;
+
+        while ((got = trace_read_binary(fp, raw, 1024)) > 0) {
+            for (k = 0; k < got; k++)
+                append_record(records, count, &capacity, TRACE_OP(raw[k]),
+                              TRACE_ADDR(raw[k]), TRACE_SIZE(raw[k]));
+        }
+    } else {
+        char op;
+        unsigned long long addr;
+        int size;
+
+        while (fscanf(fp, " %c %llx,%d", &op, &addr, &size) == 3)
+            append_record(records, count, &capacity, op, addr, size);
+    }
+    fclose(fp);
+    return 0;
+}
+
+/* free_entry - Deallocate a cache entry (not linked into traces) */
+static void free_entry(trace_entry_t *e)
+{
+    free(e->path);
+    free(e->records);
+    free(e);
+}
+
+/*
+ * trim_cache - Drop unused traces, least recently used first, until the
+ *     cache fits its limit. Called with cache_lock held.
+ */
+static void trim_cache(void)
+{
+    while (trace_bytes > cache_limit) {
+        trace_entry_t **p, **victim = NULL, *e;
+
+        for (p = &traces; *p != NULL; p = &(*p)->next) {
+            if ((*p)->refs == 0 && !(*p)->loading &&
+                (victim == NULL || (*p)->last_used < (*victim)->last_used))
+                victim = p;
+        }
+        if (victim == NULL)
+            return;     /* everything left is in use */
+
+        e = *victim;
+        *victim = e->next;
+        trace_bytes -= e->count * sizeof(uint64_t);
+        free_entry(e);
+    }
+}
+
+/*
+ * acquire_trace - Return the parsed records of a trace file, from the
+ *     cache if the file hasn't changed since it was parsed. The entry
+ *     must be given back with release_trace(). Sets *cached to whether
+ *     the parse was skipped. Returns NULL (with errno set) if the file
+ *     can't be read.
+ */
+static trace_entry_t *acquire_trace(const char *path, int *cached)
+{
+    struct stat st;
+    trace_entry_t **p, *e;
+    int status, err;
+
+    if (stat(path, &st) < 0)
+        return NULL;
+
+    pthread_mutex_lock(&cache_lock);
+    for (p = &traces; (e = *p) != NULL; ) {
+        if (strcmp(e->path, path) == 0) {
+            if (e->dev == st.st_dev && e->ino == st.st_ino && e->size == st.st_size &&
+                e->mtime.tv_sec == st.st_mtim.tv_sec &&
+                e->mtime.tv_nsec == st.st_mtim.tv_nsec) {
+                e->refs++;
+                e->last_used = ++cache_clock;
+                /* another job is parsing it, so wait for that parse */
+                while (e->loading)
+                    pthread_cond_wait(&trace_loaded, &cache_lock);
+                if (e->error) {
+                    /* the failed entry is already unlinked, last one out frees it */
+                    err = e->error;
+                    if (--e->refs == 0)
+                        free_entry(e);
+                    pthread_mutex_unlock(&cache_lock);
+                    errno = err;
+                    return NULL;
+                }
+                trace_hits++;
+                pthread_mutex_unlock(&cache_lock);
+                *cached = 1;
+                return e;
+            }
+            if (e->refs == 0) {
+                /* the file changed since it was parsed */
+                *p = e->next;
+                trace_bytes -= e->count * sizeof(uint64_t);
+                free_entry(e);
+                continue;
+            }
+        }
+        p = &e->next;
+    }
+
+    /* Insert the entry before parsing, so jobs that want the same trace
+       meanwhile find it and wait instead of parsing it again */
+    e = calloc(1, sizeof(trace_entry_t));
+    if (e == NULL || (e->path = strdup(path)) == NULL) {
+        free(e);
+        pthread_mutex_unlock(&cache_lock);
+        errno = ENOMEM;
+        return NULL;
+    }
+    e->dev = st.st_dev;
+    e->ino = st.st_ino;
+    e->size = st.st_size;
+    e->mtime = st.st_mtim;
+    e->refs = 1;
+    e->loading = 1;
+    e->last_used = ++cache_clock;
+    e->next = traces;
+    traces = e;
+    pthread_mutex_unlock(&cache_lock);
+
+    /* Parse without the lock, so other jobs keep running meanwhile */
+    status = load_trace(path, &e->records, &e->count);
+    err = errno;
+
+    pthread_mutex_lock(&cache_lock);
+    e->loading = 0;
+    if (status < 0) {
+        e->error = err ? err : EIO;
+        for (p = &traces; *p != e; p = &(*p)->next)
+            ;
+        *p = e->next;
+    } else {
+        trace_bytes += e->count * sizeof(uint64_t);
+        trace_loads++;
+        trim_cache();
+    }
+    pthread_cond_broadcast(&trace_loaded);
+    if (status < 0) {
+        if (--e->refs == 0)
+            free_entry(e);
+        pthread_mutex_unlock(&cache_lock);
+        errno = err;
+        return NULL;
+    }
+    pthread_mutex_unlock(&cache_lock);
+    *cached = 0;
+    return e;
+}
+
+/* release_trace - Give back an entry from acquire_trace() */
+static void release_trace(trace_entry_t *e)
+{
+    pthread_mutex_lock(&cache_lock);
+    e->refs--;
+    trim_cache();
+    pthread_mutex_unlock(&cache_lock);
+}
+
+/*
+ * simulate - Run records through csim's S x E LRU cache with 2^b byte
+ *     blocks (I records are already gone, M records access twice).
+ *     Returns -1 if the cache is too large to allocate.
+ */
+static int simulate(const uint64_t *records, size_t count, int s, int E, int b,
+                    sim_result_t *res)
+{
+    cacheData data;
+    cache sets;
+    simulateFunction sim;
+    int sparse;
+    size_t i;
+
+    memset(res, 0, sizeof(*res));
+    memset(&data, 0, sizeof(data));
+    data.sets = s;
+    data.E = E;
+    data.blocks = b;
+    data = finishGeometry(data);
+
+    /* Same storage choice as csim: sparse once a dense cache gets huge */
+    sparse = (long long)data.S * E * sizeof(cacheSetLine) >= SPARSE_MIN_BYTES;
+    sets = generateCache(data.S, E, data.B, sparse);
+    if (sparse ? sets.pages == NULL : sets.allLines == NULL)
+        return -1;
+    sim = pickSimulator(E, sparse, 0);
+
+    for (i = 0; i < count; i++) {
+        address_t addr = TRACE_ADDR(records[i]);
+
+        sim(sets, &data, addr);
+        if (TRACE_OP(records[i]) == 'M')
+            sim(sets, &data, addr);
+    }
+    res->hits = data.hits;
+    res->misses = data.misses;
+    res->evictions = data.evictions;
+    res->accesses = count;
+    freeCache(sets, data.S, E, data.B);
+    return 0;
+}
+
+/*
+ * read_batch - Read inline trace records up to the "end" line. Returns
+ *     0 on success, -1 if the connection closed first.
+ */
+static int read_batch(FILE *in, uint64_t **records, size_t *count)
+{
+    char line[MAX_LINE], op;
+    unsigned long long addr;
+    int size;
+    size_t capacity = 0;
+
+    *records = NULL;
+    *count = 0;
+    while (fgets(line, sizeof(line), in) != NULL) {
+        if (strncmp(line, "end", 3) == 0)
+            return 0;
+        if (sscanf(line, " %c %llx,%d", &op, &addr, &size) == 3)
+            append_record(records, count, &capacity, op, addr, size);
+    }
+    return -1;
+}
+
+/*
+ * run_job - Run one sim job on a worker and write its reply line into
+ *     job->reply.
+ */
+static void run_job(job_t *job)
+{
+    trace_entry_t *entry = NULL;
+    const uint64_t *records = job->records;
+    size_t count = job->count;
+    int cached = 0;
+    sim_result_t res;
+    double start;
+
+    if (job->path != NULL) {
+        entry = acquire_trace(job->path, &cached);
+        if (entry == NULL) {
+            snprintf(job->reply, sizeof(job->reply), "error %s: %s\n", job->path,
+                     strerror(errno));
+            return;
+        }
+        records = entry->records;
+        count = entry->count;
+    }
+
+    start = now();
+    if (simulate(records, count, job->s, job->E, job->b, &res) < 0)
+        snprintf(job->reply, sizeof(job->reply), "error out of memory for the cache\n");
+    else
+        snprintf(job->reply, sizeof(job->reply),
+                 "ok hits:%llu misses:%llu evictions:%llu accesses:%llu cached:%d sim_s:%.6f\n",
+                 res.hits, res.misses, res.evictions, res.accesses, cached, now() - start);
+
+    if (entry != NULL)
+        release_trace(entry);
+
+    pthread_mutex_lock(&cache_lock);
+    jobs_run++;
+    pthread_mutex_unlock(&cache_lock);
+}
+
+/* run_in_pool - Queue a job for the workers and wait until it is done */
+static void run_in_pool(job_t *job)
+{
+    job->done = 0;
+    pthread_cond_init(&job->finished, NULL);
+
+    pthread_mutex_lock(&queue_lock);
+    while (queue_count == QUEUE_SIZE)
+        pthread_cond_wait(&queue_space, &queue_lock);
+    queue[(queue_head + queue_count) % QUEUE_SIZE] = job;
+    queue_count++;
+    pthread_cond_signal(&queue_ready);
+    while (!job->done)
+        pthread_cond_wait(&job->finished, &queue_lock);
+    pthread_mutex_unlock(&queue_lock);
+
+    pthread_cond_destroy(&job->finished);
+}
+
+/*
+ * handle_sim - Parse one sim request, run it on the pool and write its
+ *     reply. Returns -1 if the connection should be closed.
+ */
+static int handle_sim(char *args, FILE *in, FILE *out)
+{
+    int batch = 0;
+    char *bad = NULL, *tok, *save;
+    job_t job;
+
+    memset(&job, 0, sizeof(job));
+    job.s = job.E = job.b = -1;
+    for (tok = strtok_r(args, " \t\r\n", &save); tok != NULL;
+         tok = strtok_r(NULL, " \t\r\n", &save)) {
+        if (!strncmp(tok, "s=", 2))
+            job.s = atoi(tok + 2);
+        else if (!strncmp(tok, "E=", 2))
+            job.E = atoi(tok + 2);
+        else if (!strncmp(tok, "b=", 2))
+            job.b = atoi(tok + 2);
+        else if (!strncmp(tok, "trace=", 6))
+            job.path = tok + 6;
+        else if (!strcmp(tok, "batch"))
+            batch = 1;
+        else if (bad == NULL)
+            bad = tok;
+    }
+
+    /* Read an inline batch before any error, so the stream stays in step */
+    if (batch && read_batch(in, &job.records, &job.count) < 0) {
+        free(job.records);
+        return -1;
+    }
+    if (bad != NULL) {
+        fprintf(out, "error unknown argument %s\n", bad);
+    } else if (job.s < 0 || job.E <= 0 || job.b < 0 || job.s + job.b > 48) {
+        fprintf(out, "error sim needs s=<s> E=<E> b=<b> with s + b <= 48\n");
+    } else if ((unsigned long long)job.E > MAX_LINES ||
+               ((unsigned long long)1 << job.s) > MAX_LINES / job.E) {
+        fprintf(out, "error cache of more than %llu lines\n", MAX_LINES);
+    } else if (batch == (job.path != NULL)) {
+        fprintf(out, "error sim needs exactly one of trace=<path> and batch\n");
+    } else {
+        run_in_pool(&job);
+        fputs(job.reply, out);
+    }
+    free(job.records);
+    return 0;
+}
+
+/* add_conn - Remember an open connection, so shutdown can stop its reads */
+static int add_conn(int fd)
+{
+    pthread_mutex_lock(&conn_lock);
+    if (conn_count == conn_capacity) {
+        int capacity = conn_capacity ? conn_capacity * 2 : 16;
+        int *grown = realloc(conns, capacity * sizeof(int));
+
+        if (grown == NULL) {
+            pthread_mutex_unlock(&conn_lock);
+            return -1;
+        }
+        conns = grown;
+        conn_capacity = capacity;
+    }
+    conns[conn_count++] = fd;
+    pthread_mutex_unlock(&conn_lock);
+    return 0;
+}
+
+/* remove_conn - Forget a connection. Called with conn_lock held. */
+static void remove_conn(int fd)
+{
+    int i;
+
+    for (i = 0; i < conn_count; i++) {
+        if (conns[i] == fd) {
+            conns[i] = conns[--conn_count];
+            break;
+        }
+    }
+    pthread_cond_signal(&conn_closed);
+}
+
+/* serve_client - Answer requests on one connection until it closes */
+static void *serve_client(void *arg)
+{
+    int fd = (int)(intptr_t)arg;
+    FILE *in = fdopen(fd, "r");
+    FILE *out = fdopen(dup(fd), "w");
+    char line[MAX_LINE];
+
+    while (in != NULL && out != NULL && fgets(line, sizeof(line), in) != NULL) {
+        int status = 0;
+
+        if (!strncmp(line, "sim", 3) && (line[3] == ' ' || line[3] == '\n')) {
+            status = handle_sim(line + 3, in, out);
+        } else if (!strncmp(line, "stats", 5)) {
+            pthread_mutex_lock(&cache_lock);
+            fprintf(out, "ok jobs:%llu trace_loads:%llu trace_hits:%llu trace_bytes:%llu\n",
+                    jobs_run, trace_loads, trace_hits, (unsigned long long)trace_bytes);
+            pthread_mutex_unlock(&cache_lock);
+        } else if (!strncmp(line, "shutdown", 8)) {
+            fprintf(out, "ok\n");
+            stopping = 1;
+            /* wakes the accept() in main */
+            shutdown(listen_fd, SHUT_RDWR);
+            status = -1;
+        } else {
+            fprintf(out, "error unknown request\n");
+        }
+        if (fflush(out) != 0 || status < 0)
+            break;
+    }
+
+    /* Close while holding conn_lock, so main never shuts down a reused fd */
+    pthread_mutex_lock(&conn_lock);
+    remove_conn(fd);
+    if (in != NULL)
+        fclose(in);
+    else
+        close(fd);
+    if (out != NULL)
+        fclose(out);
+    pthread_mutex_unlock(&conn_lock);
+    return NULL;
+}
+
+/* worker - Run jobs off the queue until the pool is stopped */
+static void *worker(void *arg)
+{
+    job_t *job;
+
+    for (;;) {
+        pthread_mutex_lock(&queue_lock);
+        while (queue_count == 0 && !pool_stopping)
+            pthread_cond_wait(&queue_ready, &queue_lock);
+        if (queue_count == 0) {
+            pthread_mutex_unlock(&queue_lock);
+            return NULL;
+        }
+        job = queue[queue_head];
+        queue_head = (queue_head + 1) % QUEUE_SIZE;
+        queue_count--;
+        pthread_cond_signal(&queue_space);
+        pthread_mutex_unlock(&queue_lock);
+
+        run_job(job);
+
+        pthread_mutex_lock(&queue_lock);
+        job->done = 1;
+        pthread_cond_signal(&job->finished);
+        pthread_mutex_unlock(&queue_lock);
+    }
+}
+
+/* stop_handler - SIGINT/SIGTERM handler, interrupts accept() */
+static void stop_handler(int signum)
+{
+    stopping = 1;
+}
+
+static void usage(char *argv[])
+{
+    printf("Usage: %s [-h] [-S <socket>] [-j <workers>] [-c <megabytes>]\n", argv[0]);
+    printf("Options:\n");
+    printf("  -h            Print this help message.\n");
+    printf("  -S <socket>   Unix socket to listen on (default %s).\n", DEFAULT_SOCKET);
+    printf("  -j <workers>  Jobs to run at once, whatever the number of clients\n");
+    printf("                (default: online CPUs).\n");
+    printf("  -c <mb>       Memory for cached traces (default %d).\n", DEFAULT_CACHE_MB);
+    printf("\nRequests, one per line:\n");
+    printf("  sim s=<s> E=<E> b=<b> trace=<path>\n");
+    printf("  sim s=<s> E=<E> b=<b> batch, then trace records, then a line \"end\"\n");
+    printf("  stats\n");
+    printf("  shutdown\n");
+    printf("\nExamples:\n");
+    printf("  %s -j 8 &\n", argv[0]);
+    printf("  ./test-trans -S %s -M 32 -N 32\n", DEFAULT_SOCKET);
+}
+
+/*
+ * main - Listen, give each connection a thread, and clean up the socket
+ *     on SIGINT, SIGTERM or a shutdown request
+ */
+int main(int argc, char *argv[])
+{
+    char *socket_path = DEFAULT_SOCKET;
+    int workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int c, i, fd;
+    struct sockaddr_un addr;
+    struct sigaction sa;
+    sigset_t blocked, old;
+    pthread_t *threads, client;
+    pthread_attr_t detached;
+
+    while ((c = getopt(argc, argv, "hS:j:c:")) != -1) {
+        switch (c) {
+        case 'S':
+            socket_path = optarg;
+            break;
+        case 'j':
+            workers = atoi(optarg);
+            break;
+        case 'c':
+            cache_limit = (size_t)strtoull(optarg, NULL, 0) << 20;
+            break;
+        case 'h':
+            usage(argv);
+            exit(0);
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+    if (workers < 1)
+        workers = 1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "csimd: socket path too long\n");
+        exit(1);
+    }
+    strcpy(addr.sun_path, socket_path);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        perror("csimd: socket");
+        exit(1);
+    }
+    /* A socket file nobody answers on is left over from an earlier run */
+    if (connect(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+        fprintf(stderr, "csimd: already running on %s\n", socket_path);
+        exit(1);
+    }
+    close(listen_fd);
+    unlink(socket_path);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0 || bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listen_fd, QUEUE_SIZE) < 0) {
+        perror("csimd: listen");
+        exit(1);
+    }
+
+    /* No SA_RESTART, so the signals interrupt accept() */
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = stop_handler;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    /* Other threads block the stop signals, so they always reach main */
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGINT);
+    sigaddset(&blocked, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &blocked, &old);
+    threads = malloc(workers * sizeof(pthread_t));
+    for (i = 0; i < workers; i++) {
+        if (pthread_create(&threads[i], NULL, worker, NULL) != 0) {
+            fprintf(stderr, "csimd: can't start worker %d\n", i);
+            exit(1);
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    pthread_attr_init(&detached);
+    pthread_attr_setdetachstate(&detached, PTHREAD_CREATE_DETACHED);
+
+    printf("csimd: listening on %s with %d workers\n", socket_path, workers);
+    fflush(stdout);
+
+    while (!stopping) {
+        fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || stopping)
+                continue;
+            perror("csimd: accept");
+            break;
+        }
+        if (add_conn(fd) < 0) {
+            close(fd);
+            continue;
+        }
+        pthread_sigmask(SIG_BLOCK, &blocked, &old);
+        if (pthread_create(&client, &detached, serve_client, (void *)(intptr_t)fd) != 0) {
+            pthread_mutex_lock(&conn_lock);
+            remove_conn(fd);
+            close(fd);
+            pthread_mutex_unlock(&conn_lock);
+        }
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
+    }
+
+    /* Stop reading from the clients, so idle connections close now and
+       busy ones close once their current request is answered */
+    pthread_mutex_lock(&conn_lock);
+    for (i = 0; i < conn_count; i++)
+        shutdown(conns[i], SHUT_RD);
+    while (conn_count > 0)
+        pthread_cond_wait(&conn_closed, &conn_lock);
+    pthread_mutex_unlock(&conn_lock);
+    pthread_attr_destroy(&detached);
+    free(conns);
+
+    /* No connection is left to send jobs, so stop the workers */
+    pthread_mutex_lock(&queue_lock);
+    pool_stopping = 1;
+    pthread_cond_broadcast(&queue_ready);
+    pthread_mutex_unlock(&queue_lock);
+    for (i = 0; i < workers; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+    close(listen_fd);
+    unlink(socket_path);
+
+    while (traces != NULL) {
+        trace_entry_t *e = traces;
+        traces = e->next;
+        free_entry(e);
+    }
+    printf("csimd: %llu jobs, %llu trace parses, %llu cached trace hits\n",
+           jobs_run, trace_loads, trace_hits);
+    return 0;
+}
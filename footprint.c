@@ -0,0 +1,203 @@
+/* Working-set and footprint analytics.
+ * All sketches hash the block address with the splitmix64 finalizer. The Count-Min sketch uses
+ * conservative update (only the smallest counters of a block are raised), which keeps its usual
+ * guarantee: an estimate is never below the true count, and is above it by more than e/width of
+ * all accesses with probability at most e^-depth. The hot blocks are kept in a topKHeap and the
+ * regions in a hashTable (hashtable.c).
+ *
+ * Authors: Theodore Bieber (tjbieber), James Honicker (jlhonicker)
+*/
+#include "footprint.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Adds a hash to a HyperLogLog of 2^bits registers
+static inline void hllAdd(unsigned char *registers, int bits, unsigned long long hash) {
+	unsigned long long index = hash >> (64 - bits);
+	unsigned long long rest = hash << bits;
+	unsigned char rank = rest == 0 ? 64 - bits + 1 : __builtin_clzll(rest) + 1;
+
+	if(rank > registers[index]) {
+		registers[index] = rank;
+	}
+}
+
+// Estimates the distinct hashes added to a HyperLogLog, with linear counting for small counts
+static double hllEstimate(const unsigned char *registers, int bits) {
+	double m = 1 << bits;
+	double alpha = 0.7213 / (1 + 1.079 / m);
+	double sum = 0;
+	int registercounter, zeros = 0;
+
+	for(registercounter = 0; registercounter < (1 << bits); registercounter++) {
+		sum += ldexp(1, -registers[registercounter]);
+		zeros += registers[registercounter] == 0;
+	}
+	if(alpha * m * m / sum <= 2.5 * m && zeros > 0) {
+		return m * log(m / zeros);
+	}
+	return alpha * m * m / sum;
+}
+
+footprintAnalysis createFootprint(int blocks, int topK, int regionBits) {
+	footprintAnalysis analysis;
+
+	memset(&analysis, 0, sizeof(analysis));
+	analysis.blocks = blocks;
+	analysis.regionBits = regionBits < blocks ? blocks : regionBits;
+	analysis.topK = topK;
+	analysis.registers = (unsigned char *) calloc(1 << HLL_BITS, 1);
+	analysis.counts = (unsigned long long *) calloc((size_t) CM_DEPTH << CM_WIDTH_BITS,
+		sizeof(unsigned long long));
+	analysis.hot = createTopK(topK);
+	analysis.regions = createHashTable(sizeof(regionStats), 64, MAX_REGIONS);
+	return analysis;
+}
+
+/* Adds one to a block's Count-Min counters
+ * Parameters:
+ *     hash: the block's hash, the rows use the hashes hash + row * step (double hashing)
+ * return: the block's new estimated count
+*/
+static unsigned long long countMinAdd(footprintAnalysis *analysis, unsigned long long hash) {
+	unsigned long long step = (hash >> 32) | 1;
+	unsigned long long *counters[CM_DEPTH];
+	unsigned long long estimate = ~0ULL;
+	int rowcounter;
+
+	for(rowcounter = 0; rowcounter < CM_DEPTH; rowcounter++) {
+		unsigned long long column = (hash + rowcounter * step) & ((1ULL << CM_WIDTH_BITS) - 1);
+		counters[rowcounter] = &analysis->counts[((unsigned long long) rowcounter << CM_WIDTH_BITS) +
+			column];
+		if(*counters[rowcounter] < estimate) {
+			estimate = *counters[rowcounter];
+		}
+	}
+	estimate++;
+	for(rowcounter = 0; rowcounter < CM_DEPTH; rowcounter++) {
+		if(*counters[rowcounter] < estimate) {
+			*counters[rowcounter] = estimate;
+		}
+	}
+	return estimate;
+}
+
+void footprintAccess(footprintAnalysis *analysis, unsigned long long address) {
+	unsigned long long block = address >> analysis->blocks;
+	unsigned long long hash = hashMix(block);
+	regionStats *region;
+
+	analysis->accesses++;
+	hllAdd(analysis->registers, HLL_BITS, hash);
+	topKUpdate(&analysis->hot, block, countMinAdd(analysis, hash));
+
+	region = (regionStats *) hashTableGet(&analysis->regions, address >> analysis->regionBits);
+	if(region != NULL) {
+		region->region = address >> analysis->regionBits;
+		region->accesses++;
+		hllAdd(region->registers, REGION_HLL_BITS, hash);
+	} else if(analysis->untrackedAccesses++ == 0) {
+		fprintf(stderr, "Warning: more than %d regions touched, accesses to later regions are "
+			"not itemized (use -A %d,<bits> with more bits for larger regions)\n", MAX_REGIONS,
+			analysis->topK);
+	}
+
+	// footprint so far at every power of two accesses
+	if(analysis->accesses >= (1ULL << FIRST_CHECKPOINT_BITS) &&
+			(analysis->accesses & (analysis->accesses - 1)) == 0 &&
+			analysis->amtCheckpoints < MAX_CHECKPOINTS) {
+		analysis->checkpointAccesses[analysis->amtCheckpoints] = analysis->accesses;
+		analysis->checkpointBlocks[analysis->amtCheckpoints] = hllEstimate(analysis->registers,
+			HLL_BITS);
+		analysis->amtCheckpoints++;
+	}
+}
+
+// Sorts regions by accesses, most first
+static int compareRegions(const void *a, const void *b) {
+	const regionStats *x = (const regionStats *) a;
+	const regionStats *y = (const regionStats *) b;
+
+	if(x->accesses != y->accesses) {
+		return x->accesses < y->accesses ? 1 : -1;
+	}
+	return x->region < y->region ? -1 : (x->region > y->region);
+}
+
+void printFootprint(footprintAnalysis *analysis) {
+	double blockBytes = ldexp(1, analysis->blocks);
+	double hllError = 1.04 / sqrt(1 << HLL_BITS);
+	double regionError = 1.04 / sqrt(1 << REGION_HLL_BITS);
+	double epsilon = exp(1) / (1 << CM_WIDTH_BITS);
+	double blocksPerRegion = ldexp(1, analysis->regionBits - analysis->blocks);
+	const char *unitNames[] = { "bytes", "KB", "MB", "GB" };
+	int regionUnit = analysis->regionBits / 10 > 3 ? 3 : analysis->regionBits / 10;
+	double total = hllEstimate(analysis->registers, HLL_BITS);
+	heapEntry *hot = (heapEntry *) malloc(sizeof(heapEntry) * (analysis->hot.size + 1));
+	regionStats *regions = (regionStats *) malloc(sizeof(regionStats) *
+		(analysis->regions.count + 1));
+	unsigned long long amtUsed;
+	int amtHot, printcounter;
+
+	printf("footprint analysis (%.0f byte blocks), data accesses:%llu\n", blockBytes,
+		analysis->accesses);
+
+	printf("distinct blocks (HyperLogLog, %d registers, standard error %.2f%%):\n", 1 << HLL_BITS,
+		100 * hllError);
+	for(printcounter = 0; printcounter < analysis->amtCheckpoints; printcounter++) {
+		printf("  after %llu accesses: %.0f blocks (%.1f KB)\n",
+			analysis->checkpointAccesses[printcounter], analysis->checkpointBlocks[printcounter],
+			analysis->checkpointBlocks[printcounter] * blockBytes / 1024);
+	}
+	printf("  total: %.0f blocks (%.1f KB), 95%% within %.0f-%.0f blocks\n", total,
+		total * blockBytes / 1024, total * (1 - 2 * hllError), total * (1 + 2 * hllError));
+
+	// the report sorts copies, the sketches are left as they are
+	amtHot = topKSorted(&analysis->hot, hot);
+	printf("hottest %d blocks (Count-Min %dx%d: never under, over by at most %.0f accesses "
+		"with probability %.2f%%):\n", amtHot, CM_DEPTH, 1 << CM_WIDTH_BITS,
+		ceil(epsilon * analysis->accesses), 100 * (1 - exp(-CM_DEPTH)));
+	printf("%18s %12s %8s\n", "block address", "accesses", "share");
+	for(printcounter = 0; printcounter < amtHot; printcounter++) {
+		printf("%18llx %12llu %7.2f%%\n", hot[printcounter].key << analysis->blocks,
+			hot[printcounter].count, 100.0 * hot[printcounter].count / analysis->accesses);
+	}
+
+	amtUsed = hashTableCopy(&analysis->regions, regions);
+	qsort(regions, amtUsed, sizeof(regionStats), compareRegions);
+	printf("densest %d of %llu regions of %.0f %s (distinct blocks per region: standard error "
+		"%.1f%%)", amtUsed < (unsigned long long) analysis->topK ? (int) amtUsed : analysis->topK,
+		amtUsed, ldexp(1, analysis->regionBits - 10 * regionUnit), unitNames[regionUnit],
+		100 * regionError);
+	if(analysis->untrackedAccesses > 0) {
+		printf(", %llu accesses past the first %d regions not itemized", analysis->untrackedAccesses,
+			MAX_REGIONS);
+	}
+	printf(":\n%18s %12s %10s %9s %12s\n", "region", "accesses", "blocks", "touched", "per block");
+	for(printcounter = 0; printcounter < analysis->topK && (unsigned long long) printcounter < amtUsed;
+			printcounter++) {
+		regionStats *region = &regions[printcounter];
+		double distinct = hllEstimate(region->registers, REGION_HLL_BITS);
+		if(distinct > blocksPerRegion) {
+			distinct = blocksPerRegion;
+		}
+		if(distinct < 1) {
+			distinct = 1;
+		}
+		printf("%18llx %12llu %10.0f %8.2f%% %12.1f\n", region->region << analysis->regionBits,
+			region->accesses, distinct, 100 * distinct / blocksPerRegion,
+			region->accesses / distinct);
+	}
+	free(hot);
+	free(regions);
+}
+
+void freeFootprint(footprintAnalysis *analysis) {
+	free(analysis->registers);
+	free(analysis->counts);
+	freeTopK(&analysis->hot);
+	freeHashTable(&analysis->regions);
+	analysis->registers = NULL;
+}
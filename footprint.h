@@ -0,0 +1,68 @@
+/* Working-set and footprint analytics.
+ * Every data access is counted at block (-b) granularity in fixed-size sketches, so the memory
+ * used doesn't grow with the trace: a HyperLogLog estimates the distinct blocks touched so far
+ * (reported at every power of two accesses), a Count-Min sketch with a min-heap of its top
+ * estimates finds the hottest blocks, and each address region keeps its access count and a small
+ * HyperLogLog of its own. Each report comes with the error bound of the sketch behind it.
+ *
+ * Authors: Theodore Bieber (tjbieber), James Honicker (jlhonicker)
+*/
+#ifndef FOOTPRINT_H
+#define FOOTPRINT_H
+
+#include "hashtable.h"
+
+// HyperLogLog of the whole trace: 2^HLL_BITS one-byte registers
+#define HLL_BITS 14
+// Count-Min sketch: CM_DEPTH rows of 2^CM_WIDTH_BITS counters
+#define CM_DEPTH 5
+#define CM_WIDTH_BITS 16
+// Per-region HyperLogLog registers (2^REGION_HLL_BITS), and the most regions itemized
+#define REGION_HLL_BITS 8
+#define MAX_REGIONS 65536
+// Footprint checkpoints: one per power of two accesses, starting at 2^FIRST_CHECKPOINT_BITS
+#define FIRST_CHECKPOINT_BITS 10
+#define MAX_CHECKPOINTS 64
+
+typedef struct {
+	unsigned long long region;
+	unsigned long long accesses;
+	unsigned char registers[1 << REGION_HLL_BITS];
+} regionStats;
+
+typedef struct {
+	int blocks; // b
+	int regionBits; // log2 of the region size in bytes
+	unsigned long long accesses;
+
+	unsigned char *registers; // the trace's HyperLogLog
+	unsigned long long checkpointAccesses[MAX_CHECKPOINTS];
+	double checkpointBlocks[MAX_CHECKPOINTS];
+	int amtCheckpoints;
+
+	unsigned long long *counts; // Count-Min, row i is counts[i << CM_WIDTH_BITS ..]
+	topKHeap hot; // the topK blocks with the highest estimates (the heap's counts)
+	int topK;
+
+	hashTable regions; // regionStats by region, at most MAX_REGIONS
+	unsigned long long untrackedAccesses; // to regions past the first MAX_REGIONS
+} footprintAnalysis;
+
+/* Allocates the sketches
+ * Parameters:
+ *     blocks: b, the block size everything is counted in
+ *     topK: hottest blocks (and densest regions) to report
+ *     regionBits: log2 of the region size in bytes, at least blocks
+*/
+footprintAnalysis createFootprint(int blocks, int topK, int regionBits);
+
+// Counts one data access
+void footprintAccess(footprintAnalysis *analysis, unsigned long long address);
+
+// Prints the footprint over time, the hottest blocks and the regions, with their error bounds
+void printFootprint(footprintAnalysis *analysis);
+
+// Deallocates the sketches
+void freeFootprint(footprintAnalysis *analysis);
+
+#endif /* FOOTPRINT_H */
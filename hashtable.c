@@ -0,0 +1,240 @@
+/* Hash tables and top-K heaps shared by the analyses.
+ * Entry pointers returned by a table stay valid until the next hashTableGet (which may grow the
+ * table) or hashTableRemove (which may shift entries back).
+ *
+ * Authors: Theodore Bieber (tjbieber), James Honicker (jlhonicker)
+*/
+#include "hashtable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Returns the entry in a slot
+static inline void *entryAt(hashTable *table, unsigned long long slot) {
+	return hashTableSlot(table, slot) + 1;
+}
+
+/* Finds the slot of a key
+ * return: the slot holding it, or the empty slot it would go in
+*/
+static inline unsigned long long findSlot(hashTable *table, unsigned long long key) {
+	unsigned long long mask = table->capacity - 1;
+	unsigned long long slot = hashTableHome(table, key);
+	unsigned long long tag;
+
+	if(key + 1 == 0) {
+		return table->capacity;
+	}
+	while((tag = hashTableSlot(table, slot)->tag) != 0 && tag != key + 1) {
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+hashTable createHashTable(size_t entrySize, unsigned long long capacity, unsigned long long limit) {
+	hashTable table;
+
+	table.entrySize = entrySize;
+	table.capacity = 16;
+	table.shift = 60;
+	while(table.capacity < capacity) {
+		table.capacity <<= 1;
+		table.shift--;
+	}
+	table.count = 0;
+	table.limit = limit;
+	table.slotSize = (sizeof(hashSlot) + entrySize + 7) & ~(size_t) 7;
+	table.slots = (char *) calloc(table.capacity + 1, table.slotSize);
+	if(table.slots == NULL) {
+		printf("Out of memory for a hash table\n");
+		exit(1);
+	}
+	return table;
+}
+
+// Copies a whole slot a word at a time, since slots are a multiple of 8 bytes
+static inline void copySlot(hashTable *table, unsigned long long to, unsigned long long from) {
+	unsigned long long *toWords = (unsigned long long *) hashTableSlot(table, to);
+	unsigned long long *fromWords = (unsigned long long *) hashTableSlot(table, from);
+	size_t word;
+
+	for(word = 0; word < table->slotSize / 8; word++) {
+		toWords[word] = fromWords[word];
+	}
+}
+
+// Doubles the table, rehashing every entry
+static void growHashTable(hashTable *table) {
+	hashTable bigger = createHashTable(table->entrySize, table->capacity * 2, table->limit);
+	unsigned long long slot, newSlot;
+
+	for(slot = 0; slot <= table->capacity; slot++) {
+		if(hashTableSlot(table, slot)->tag) {
+			newSlot = slot == table->capacity ? bigger.capacity :
+				findSlot(&bigger, hashTableSlot(table, slot)->tag - 1);
+			memcpy(hashTableSlot(&bigger, newSlot), hashTableSlot(table, slot), table->slotSize);
+		}
+	}
+	bigger.count = table->count;
+	freeHashTable(table);
+	*table = bigger;
+}
+
+void *hashTableGet(hashTable *table, unsigned long long key) {
+	unsigned long long slot;
+
+	if((table->count + 1) * 4 > table->capacity * 3 &&
+			(table->limit == 0 || table->count < table->limit)) {
+		growHashTable(table);
+	}
+
+	slot = findSlot(table, key);
+	if(!hashTableSlot(table, slot)->tag) {
+		if(table->limit != 0 && table->count >= table->limit) {
+			return NULL;
+		}
+		hashTableSlot(table, slot)->tag = slot == table->capacity ? 1 : key + 1;
+		table->count++;
+	}
+	return entryAt(table, slot);
+}
+
+void hashTableRemove(hashTable *table, unsigned long long key) {
+	unsigned long long mask = table->capacity - 1;
+	unsigned long long slot = findSlot(table, key);
+	unsigned long long next = slot;
+	unsigned long long home;
+	int stays;
+
+	if(!hashTableSlot(table, slot)->tag) {
+		return;
+	}
+	while(slot != table->capacity) {
+		next = (next + 1) & mask;
+		if(!hashTableSlot(table, next)->tag) {
+			break;
+		}
+		home = hashTableHome(table, hashTableSlot(table, next)->tag - 1);
+		// move it back unless its home lies cyclically in (slot, next]
+		stays = slot <= next ? (home > slot && home <= next) : (home > slot || home <= next);
+		if(!stays) {
+			copySlot(table, slot, next);
+			slot = next;
+		}
+	}
+	memset(hashTableSlot(table, slot), 0, table->slotSize);
+	table->count--;
+}
+
+unsigned long long hashTableCopy(hashTable *table, void *out) {
+	unsigned long long slot, amtCopied = 0;
+
+	for(slot = 0; slot <= table->capacity; slot++) {
+		if(hashTableSlot(table, slot)->tag) {
+			memcpy((char *) out + amtCopied * table->entrySize, entryAt(table, slot),
+				table->entrySize);
+			amtCopied++;
+		}
+	}
+	return amtCopied;
+}
+
+void freeHashTable(hashTable *table) {
+	free(table->slots);
+	table->slots = NULL;
+}
+
+topKHeap createTopK(int k) {
+	topKHeap heap;
+
+	heap.k = k;
+	heap.size = 0;
+	heap.entries = (heapEntry *) calloc(k + 1, sizeof(heapEntry));
+	heap.index = createHashTable(sizeof(int), (unsigned long long) k * 2, 0);
+	return heap;
+}
+
+// Puts an entry in a heap position and points its index entry at it
+static void placeHeapEntry(topKHeap *heap, int position, heapEntry entry) {
+	heap->entries[position] = entry;
+	*(int *) hashTableGet(&heap->index, entry.key) = position;
+}
+
+// Moves a heap entry towards the leaves until its children are at least as large
+static void siftDown(topKHeap *heap, int position) {
+	heapEntry entry = heap->entries[position];
+
+	for(;;) {
+		int child = position * 2 + 1;
+		if(child >= heap->size) {
+			break;
+		}
+		if(child + 1 < heap->size && heap->entries[child + 1].count < heap->entries[child].count) {
+			child++;
+		}
+		if(heap->entries[child].count >= entry.count) {
+			break;
+		}
+		placeHeapEntry(heap, position, heap->entries[child]);
+		position = child;
+	}
+	placeHeapEntry(heap, position, entry);
+}
+
+// Moves a heap entry towards the root until its parent is no larger
+static void siftUp(topKHeap *heap, int position) {
+	heapEntry entry = heap->entries[position];
+
+	while(position > 0 && heap->entries[(position - 1) / 2].count > entry.count) {
+		placeHeapEntry(heap, position, heap->entries[(position - 1) / 2]);
+		position = (position - 1) / 2;
+	}
+	placeHeapEntry(heap, position, entry);
+}
+
+void topKUpdate(topKHeap *heap, unsigned long long key, unsigned long long count) {
+	int *position = (int *) hashTableFind(&heap->index, key);
+	heapEntry entry;
+
+	if(position != NULL) {
+		// already in the heap: its count only went up
+		heap->entries[*position].count = count;
+		siftDown(heap, *position);
+		return;
+	}
+
+	entry.key = key;
+	entry.count = count;
+	if(heap->size < heap->k) {
+		heap->entries[heap->size++] = entry;
+		siftUp(heap, heap->size - 1);
+	} else if(heap->k > 0 && count > heap->entries[0].count) {
+		// replaces the smallest of the k
+		hashTableRemove(&heap->index, heap->entries[0].key);
+		heap->entries[0] = entry;
+		siftDown(heap, 0);
+	}
+}
+
+// Sorts heap entries by count, most first
+static int compareHeapEntries(const void *a, const void *b) {
+	const heapEntry *x = (const heapEntry *) a;
+	const heapEntry *y = (const heapEntry *) b;
+
+	if(x->count != y->count) {
+		return x->count < y->count ? 1 : -1;
+	}
+	return x->key < y->key ? -1 : (x->key > y->key);
+}
+
+int topKSorted(topKHeap *heap, heapEntry *out) {
+	memcpy(out, heap->entries, sizeof(heapEntry) * heap->size);
+	qsort(out, heap->size, sizeof(heapEntry), compareHeapEntries);
+	return heap->size;
+}
+
+void freeTopK(topKHeap *heap) {
+	free(heap->entries);
+	freeHashTable(&heap->index);
+	heap->entries = NULL;
+}
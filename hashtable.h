@@ -0,0 +1,117 @@
+/* Hash tables and top-K heaps shared by the analyses.
+ * hashTable is an open-addressed table of fixed-size entries keyed by an unsigned long long, with
+ * linear probing. It doubles once it is 3/4 full, and deletes by shifting later entries back, so
+ * there are no tombstones. topKHeap keeps the K keys with the highest counts seen so far, with a
+ * hashTable from key to heap position so a key already in it is found without a scan.
+ *
+ * Authors: Theodore Bieber (tjbieber), James Honicker (jlhonicker)
+*/
+#ifndef HASHTABLE_H
+#define HASHTABLE_H
+
+#include <stddef.h>
+
+// splitmix64 finalizer, spreads a key over all 64 bits (for sketches and seeded choices)
+static inline unsigned long long hashMix(unsigned long long x) {
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+// Header of a slot, followed in the same slot by its entry so a lookup touches one cache line
+typedef struct {
+	unsigned long long tag; // key + 1, 0 for an empty slot
+} hashSlot;
+
+typedef struct {
+	// capacity slots of slotSize bytes, entries zeroed when added, then one spare slot for the key
+	// ~0, whose tag would wrap to 0 (its tag is 1 while it is in the table)
+	char *slots;
+	size_t slotSize; // header plus entry, rounded up to 8 bytes
+	size_t entrySize;
+	unsigned long long capacity; // always a power of two
+	int shift; // 64 - log2(capacity)
+	unsigned long long count;
+	unsigned long long limit; // most keys held (the table stops growing there), 0 for no limit
+} hashTable;
+
+/* Allocates an empty table
+ * Parameters:
+ *     entrySize: bytes per entry
+ *     capacity: initial slots, rounded up to a power of two
+ *     limit: most keys held, 0 for no limit
+*/
+hashTable createHashTable(size_t entrySize, unsigned long long capacity, unsigned long long limit);
+
+// Returns a slot's header
+static inline hashSlot *hashTableSlot(hashTable *table, unsigned long long slot) {
+	return (hashSlot *) (table->slots + slot * table->slotSize);
+}
+
+// Home slot of a key: the top bits of a Fibonacci multiply, which spreads nearby keys in one step
+static inline unsigned long long hashTableHome(hashTable *table, unsigned long long key) {
+	return (key * 0x9e3779b97f4a7c15ULL) >> table->shift;
+}
+
+// Finds a key's entry, NULL if it isn't in the table. Inline, since the analyses look up every access.
+static inline void *hashTableFind(hashTable *table, unsigned long long key) {
+	unsigned long long mask = table->capacity - 1;
+	unsigned long long slot = hashTableHome(table, key);
+	hashSlot *header;
+
+	if(key + 1 == 0) {
+		header = hashTableSlot(table, table->capacity);
+		return header->tag ? header + 1 : NULL;
+	}
+	while((header = hashTableSlot(table, slot))->tag) {
+		if(header->tag == key + 1) {
+			return header + 1;
+		}
+		slot = (slot + 1) & mask;
+	}
+	return NULL;
+}
+
+// Finds (or adds, zeroed) a key's entry. NULL once the table holds limit keys and this isn't one.
+void *hashTableGet(hashTable *table, unsigned long long key);
+
+// Removes a key, if it is in the table
+void hashTableRemove(hashTable *table, unsigned long long key);
+
+/* Copies every entry to out (count entries of entrySize), in no particular order
+ * return: the number of entries copied
+*/
+unsigned long long hashTableCopy(hashTable *table, void *out);
+
+// Deallocates the table
+void freeHashTable(hashTable *table);
+
+// One key of a top-K heap
+typedef struct {
+	unsigned long long key;
+	unsigned long long count;
+} heapEntry;
+
+typedef struct {
+	heapEntry *entries; // min-heap, the smallest count at the root
+	int size;
+	int k;
+	hashTable index; // key -> heap position (int)
+} topKHeap;
+
+// Allocates an empty heap that keeps the k highest counts
+topKHeap createTopK(int k);
+
+// Updates a key's count, which only ever goes up, and keeps the k highest
+void topKUpdate(topKHeap *heap, unsigned long long key, unsigned long long count);
+
+/* Copies the heap to out (size entries), highest count first, ties by key
+ * return: the number of entries copied
+*/
+int topKSorted(topKHeap *heap, heapEntry *out);
+
+// Deallocates the heap
+void freeTopK(topKHeap *heap);
+
+#endif /* HASHTABLE_H */
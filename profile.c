@@ -0,0 +1,160 @@
+/* Per-instruction miss profile.
+ * The counts live in a hashTable (hashtable.c) keyed by instruction address. At the end a copy
+ * of the table is sorted by misses, and the top entries can be symbolized with addr2line.
+ *
+ * Authors: Theodore Bieber (tjbieber), James Honicker (jlhonicker)
+*/
+#define _POSIX_C_SOURCE 200809L
+#include "profile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+// Longest function or file:line name printed from addr2line
+#define SYMBOL_MAX 256
+
+missProfile createProfile(void) {
+	missProfile profile;
+
+	profile.table = createHashTable(sizeof(instructionStats), 1024, 0);
+	return profile;
+}
+
+void recordProfile(missProfile *profile, unsigned long long instruction, int hits, int misses,
+		int evictions) {
+	instructionStats *stats = (instructionStats *) hashTableGet(&profile->table, instruction);
+
+	stats->instruction = instruction;
+	stats->accesses++;
+	stats->hits += hits;
+	stats->misses += misses;
+	stats->evictions += evictions;
+}
+
+// Sorts by misses, then evictions, most first
+static int compareInstructionStats(const void *a, const void *b) {
+	const instructionStats *x = (const instructionStats *) a;
+	const instructionStats *y = (const instructionStats *) b;
+
+	if(x->misses != y->misses) {
+		return x->misses < y->misses ? 1 : -1;
+	}
+	if(x->evictions != y->evictions) {
+		return x->evictions < y->evictions ? 1 : -1;
+	}
+	return x->instruction < y->instruction ? -1 : (x->instruction > y->instruction);
+}
+
+/* Runs addr2line once for all of the printed addresses
+ * It is started with execvp rather than through a shell, so the binary's path is passed as is.
+ * Parameters:
+ *     functions, locations: filled in with amtEntries names each (left empty on failure)
+*/
+static void symbolize(instructionStats *entries, int amtEntries, const char *binary,
+		unsigned long long loadOffset, char (*functions)[SYMBOL_MAX], char (*locations)[SYMBOL_MAX]) {
+	char **args = (char **) calloc(amtEntries + 6, sizeof(char *));
+	char (*addresses)[24] = calloc(amtEntries, 24);
+	int entrycounter, pipefd[2];
+	FILE *symbols;
+	pid_t pid;
+
+	if(args == NULL || addresses == NULL || pipe(pipefd) < 0) {
+		free(args);
+		free(addresses);
+		return;
+	}
+	args[0] = "addr2line";
+	args[1] = "-f";
+	args[2] = "-C";
+	args[3] = "-e";
+	args[4] = (char *) binary;
+	for(entrycounter = 0; entrycounter < amtEntries; entrycounter++) {
+		snprintf(addresses[entrycounter], 24, "0x%llx", entries[entrycounter].instruction - loadOffset);
+		args[5 + entrycounter] = addresses[entrycounter];
+	}
+
+	// the report so far must not be printed twice by the child
+	fflush(stdout);
+	pid = fork();
+	if(pid == 0) {
+		close(pipefd[0]);
+		dup2(pipefd[1], STDOUT_FILENO);
+		close(pipefd[1]);
+		execvp(args[0], args);
+		_exit(127);
+	}
+	close(pipefd[1]);
+
+	symbols = pid > 0 ? fdopen(pipefd[0], "r") : NULL;
+	if(symbols != NULL) {
+		// addr2line prints the function, then file:line, for each address in order
+		for(entrycounter = 0; entrycounter < amtEntries; entrycounter++) {
+			if(fgets(functions[entrycounter], SYMBOL_MAX, symbols) == NULL ||
+					fgets(locations[entrycounter], SYMBOL_MAX, symbols) == NULL) {
+				functions[entrycounter][0] = '\0';
+				break;
+			}
+			functions[entrycounter][strcspn(functions[entrycounter], "\n")] = '\0';
+			locations[entrycounter][strcspn(locations[entrycounter], "\n")] = '\0';
+		}
+		fclose(symbols);
+	} else {
+		close(pipefd[0]);
+	}
+	if(pid > 0) {
+		waitpid(pid, NULL, 0);
+	}
+	free(args);
+	free(addresses);
+}
+
+void printProfile(missProfile *profile, int topN, const char *binary, unsigned long long loadOffset) {
+	instructionStats *sorted = (instructionStats *) malloc(sizeof(instructionStats) *
+		(profile->table.count + 1));
+	unsigned long long amtUsed;
+	char (*functions)[SYMBOL_MAX];
+	char (*locations)[SYMBOL_MAX];
+	int printcounter;
+
+	// sort a copy, the profile itself is left as it is
+	amtUsed = hashTableCopy(&profile->table, sorted);
+	qsort(sorted, amtUsed, sizeof(instructionStats), compareInstructionStats);
+	if((unsigned long long) topN > amtUsed) {
+		topN = amtUsed;
+	}
+
+	functions = calloc(topN + 1, SYMBOL_MAX);
+	locations = calloc(topN + 1, SYMBOL_MAX);
+	if(binary != NULL && topN > 0) {
+		symbolize(sorted, topN, binary, loadOffset, functions, locations);
+	}
+
+	printf("Top %d instructions by misses (%llu instructions issued data accesses):\n", topN,
+		amtUsed);
+	printf("%18s %10s %10s %10s %10s\n", "instruction", "accesses", "hits", "misses", "evictions");
+	for(printcounter = 0; printcounter < topN; printcounter++) {
+		instructionStats *stats = &sorted[printcounter];
+		if(stats->instruction == 0) {
+			printf("%18s", "(no I record)");
+		} else {
+			printf("%18llx", stats->instruction);
+		}
+		printf(" %10u %10u %10u %10u", stats->accesses, stats->hits, stats->misses,
+			stats->evictions);
+		if(stats->instruction != 0 && functions[printcounter][0] != '\0') {
+			printf("  %s %s", functions[printcounter], locations[printcounter]);
+		}
+		printf("\n");
+	}
+
+	free(functions);
+	free(locations);
+	free(sorted);
+}
+
+void freeProfile(missProfile *profile) {
+	freeHashTable(&profile->table);
+}
@@ -0,0 +1,41 @@
+/* Per-instruction miss profile.
+ * In lackey traces every data access follows the I record of the instruction that issued it, so
+ * each data hit, miss and eviction can be charged to that instruction address.
+ *
+ * Authors: Theodore Bieber (tjbieber), James Honicker (jlhonicker)
+*/
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "hashtable.h"
+
+// Counts for one instruction address
+typedef struct {
+	unsigned long long instruction;
+	unsigned int accesses;
+	unsigned int hits;
+	unsigned int misses;
+	unsigned int evictions;
+} instructionStats;
+
+typedef struct {
+	hashTable table; // instructionStats by instruction address
+} missProfile;
+
+// Allocates an empty profile
+missProfile createProfile(void);
+
+// Charges one data access (and its outcome) to the instruction that issued it
+void recordProfile(missProfile *profile, unsigned long long instruction, int hits, int misses,
+		int evictions);
+
+/* Prints the topN instructions with the most misses. If binary is not NULL, the addresses are
+ * symbolized with addr2line after subtracting loadOffset (the load address of a PIE binary).
+ * The profile is not changed, so it can still be recorded into and printed again.
+*/
+void printProfile(missProfile *profile, int topN, const char *binary, unsigned long long loadOffset);
+
+// Deallocates the profile
+void freeProfile(missProfile *profile);
+
+#endif /* PROFILE_H */
@@ -0,0 +1,590 @@
+/*
+ * synthtrace.c - Writes large synthetic memory traces for benchmarking
+ * the cache simulator.
+ *
+ * Unlike tracegen, nothing is run under valgrind: accesses come from
+ * parameterized address patterns driven by a seeded generator, so the
+ * same options always produce the same trace. Patterns can be mixed
+ * with weights, and each access gets an L, S or M operation according
+ * to the -r ratios. Output is either the usual text format or the
+ * binary format described in tracefile.h.
+ *
+ * A named corpus of presets (-c) gives the benchmarks a fixed set of
+ * traces to compare against; -l lists them.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <getopt.h>
+#include "tracefile.h"
+
+/* Maximum number of patterns in a mix */
+#define MAX_PATTERNS 8
+
+/* Addresses are placed above this so they look like heap addresses */
+#define BASE_ADDR 0x10000000ULL
+
+/* Output is buffered in chunks of this many bytes */
+#define OUTBUF_SIZE (1 << 20)
+
+typedef enum { PAT_SEQ, PAT_STRIDE, PAT_RANDOM, PAT_ZIPF, PAT_CHASE } pattern_kind_t;
+
+static const char *pattern_names[] = { "seq", "stride", "random", "zipf", "chase" };
+
+/* One address stream of a (possibly mixed) trace */
+typedef struct {
+    pattern_kind_t kind;
+    unsigned int weight;
+    uint64_t region;      /* start address of this stream's region */
+    uint64_t pos;         /* next offset (seq/stride) or node (chase) */
+    uint32_t *next;       /* pointer-chase successor table */
+    double zipf_hIntegralX1, zipf_hIntegralN, zipf_s;
+    uint64_t zipf_scatter; /* rank multiplier, coprime to the block count */
+} pattern_t;
+
+/* Everything that describes a trace */
+typedef struct {
+    unsigned long long count;     /* -n number of accesses */
+    unsigned long long seed;      /* -s */
+    unsigned long long footprint; /* -w bytes touched per pattern */
+    unsigned int stride;          /* -S bytes */
+    unsigned int size;            /* -a access size */
+    unsigned int block;           /* -k element size for random/zipf/chase */
+    double zipf;                  /* -z exponent */
+    unsigned int ratio[3];        /* -r L:S:M */
+    char patterns[128];           /* -p pattern[:weight],... */
+} trace_spec_t;
+
+/* A named corpus entry */
+typedef struct {
+    const char *name;
+    const char *description;
+    trace_spec_t spec;
+} preset_t;
+
+/*
+ * The benchmark corpus. Counts are the defaults for a full run; -n
+ * overrides them for quick runs without changing the access pattern.
+ */
+static const preset_t presets[] = {
+    { "seq-1g", "1G sequential 8 byte loads over 256MB",
+      { 1000000000ULL, 1, 256ULL << 20, 8, 8, 64, 1.0, {100, 0, 0}, "seq" } },
+    { "stride-4k", "512M 4KB-strided accesses over 1GB, 70/30 load/store",
+      { 512000000ULL, 2, 1ULL << 30, 4096, 8, 64, 1.0, {70, 30, 0}, "stride" } },
+    { "uniform-64m", "1G uniform random accesses over 64MB",
+      { 1000000000ULL, 3, 64ULL << 20, 64, 8, 64, 1.0, {60, 30, 10}, "random" } },
+    { "zipf-hot", "1G Zipf(0.99) accesses over 1M 64 byte blocks",
+      { 1000000000ULL, 4, 64ULL << 20, 64, 8, 64, 0.99, {80, 15, 5}, "zipf" } },
+    { "chase-16m", "256M dependent pointer-chase loads over 16MB",
+      { 256000000ULL, 5, 16ULL << 20, 64, 8, 64, 1.0, {100, 0, 0}, "chase" } },
+    { "mixed-oltp", "1G mix of zipf, random, seq and chase streams",
+      { 1000000000ULL, 6, 32ULL << 20, 64, 8, 64, 0.9, {65, 25, 10},
+        "zipf:50,random:20,seq:20,chase:10" } },
+    { "small-mixed", "10M mixed accesses for quick regression runs",
+      { 10000000ULL, 7, 4ULL << 20, 64, 8, 64, 0.9, {65, 25, 10},
+        "zipf:40,random:20,seq:30,chase:10" } },
+};
+#define NUM_PRESETS (sizeof(presets) / sizeof(presets[0]))
+
+/* splitmix64 - small, fast and good enough for address streams */
+static uint64_t rng_state;
+static inline uint64_t rng_next(void)
+{
+    uint64_t z = (rng_state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/* Uniform integer in [0, n) */
+static inline uint64_t rng_below(uint64_t n)
+{
+    return rng_next() % n;
+}
+
+/* Uniform double in [0, 1) */
+static inline double rng_double(void)
+{
+    return (rng_next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/*
+ * Zipf sampling by rejection-inversion (Hormann and Derflinger), which
+ * needs no table and runs in constant expected time for any number
+ * of elements.
+ */
+static double zipf_exponent;
+
+static double zipf_helper1(double x)
+{
+    return fabs(x) > 1e-8 ? log1p(x) / x : 1 - x * (0.5 - x * (1.0 / 3 - 0.25 * x));
+}
+
+static double zipf_helper2(double x)
+{
+    return fabs(x) > 1e-8 ? expm1(x) / x : 1 + x * 0.5 * (1 + x * (1.0 / 3) * (1 + 0.25 * x));
+}
+
+static double zipf_h(double x)
+{
+    return exp(-zipf_exponent * log(x));
+}
+
+static double zipf_hIntegral(double x)
+{
+    double logX = log(x);
+    return zipf_helper2((1 - zipf_exponent) * logX) * logX;
+}
+
+static double zipf_hIntegralInverse(double x)
+{
+    double t = x * (1 - zipf_exponent);
+    if (t < -1)
+        t = -1;
+    return exp(zipf_helper1(t) * x);
+}
+
+static void zipf_init(pattern_t *p, uint64_t n)
+{
+    p->zipf_hIntegralX1 = zipf_hIntegral(1.5) - 1;
+    p->zipf_hIntegralN = zipf_hIntegral(n + 0.5);
+    p->zipf_s = 2 - zipf_hIntegralInverse(zipf_hIntegral(2.5) - zipf_h(2));
+}
+
+/* Returns a rank in [1, n]; rank 1 is the hottest element */
+static uint64_t zipf_sample(pattern_t *p, uint64_t n)
+{
+    for (;;) {
+        double u = p->zipf_hIntegralN + rng_double() * (p->zipf_hIntegralX1 - p->zipf_hIntegralN);
+        double x = zipf_hIntegralInverse(u);
+        uint64_t k = (uint64_t)(x + 0.5);
+        if (k < 1)
+            k = 1;
+        else if (k > n)
+            k = n;
+        if (k - x <= p->zipf_s || u >= zipf_hIntegral(k + 0.5) - zipf_h(k))
+            return k;
+    }
+}
+
+/*
+ * parse_patterns - Parse "name[:weight],..." into pats. Returns the
+ *     number of patterns, or -1 on a bad spec.
+ */
+static int parse_patterns(const char *spec, pattern_t *pats)
+{
+    char buf[128], *tok, *save = NULL;
+    int n = 0;
+    unsigned int k;
+
+    strncpy(buf, spec, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    for (tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        char *colon = strchr(tok, ':');
+        if (n == MAX_PATTERNS)
+            return -1;
+        pats[n].weight = 1;
+        if (colon) {
+            *colon = '\0';
+            pats[n].weight = atoi(colon + 1);
+        }
+        for (k = 0; k < sizeof(pattern_names) / sizeof(pattern_names[0]); k++) {
+            if (!strcmp(tok, pattern_names[k]))
+                break;
+        }
+        if (k == sizeof(pattern_names) / sizeof(pattern_names[0]))
+            return -1;
+        pats[n].kind = (pattern_kind_t)k;
+        n++;
+    }
+    return n;
+}
+
+/* mulmod - (a * b) % m without overflowing 64 bits, for a, b < m */
+static inline uint64_t mulmod(uint64_t a, uint64_t b, uint64_t m)
+{
+    uint64_t r = 0;
+
+    if ((a | b) < (1ULL << 32))
+        return a * b % m;
+    /* double and add; every partial sum stays below m */
+    while (b != 0) {
+        if (b & 1)
+            r = r >= m - a ? r - (m - a) : r + a;
+        a = a >= m - a ? a - (m - a) : a + a;
+        b >>= 1;
+    }
+    return r;
+}
+
+/* gcd - Greatest common divisor */
+static uint64_t gcd(uint64_t a, uint64_t b)
+{
+    uint64_t t;
+
+    while (b != 0) {
+        t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/*
+ * init_pattern - Set up the state for one stream. Each stream gets its
+ *     own region so mixed streams never alias.
+ */
+static void init_pattern(pattern_t *p, int index, const trace_spec_t *spec)
+{
+    uint64_t elems = spec->footprint / spec->block;
+    uint64_t i, j;
+    uint32_t tmp;
+
+    p->region = BASE_ADDR + (uint64_t)index * ((spec->footprint + 0xfffff) & ~0xfffffULL);
+    p->pos = 0;
+    p->next = NULL;
+
+    if (p->kind == PAT_ZIPF) {
+        zipf_init(p, elems);
+        /* Multiplying by a number coprime to elems permutes the ranks
+           for any block count; start near elems / golden ratio so
+           neighbouring ranks land far apart */
+        p->zipf_scatter = (uint64_t)(elems * 0.6180339887498949) | 1;
+        while (gcd(p->zipf_scatter, elems) != 1)
+            p->zipf_scatter++;
+    } else if (p->kind == PAT_CHASE) {
+        /* Sattolo's algorithm gives one random cycle through all nodes */
+        if (elems > UINT32_MAX) {
+            fprintf(stderr, "synthtrace: pointer-chase footprint too large\n");
+            exit(1);
+        }
+        p->next = malloc(sizeof(uint32_t) * elems);
+        if (!p->next) {
+            fprintf(stderr, "synthtrace: out of memory\n");
+            exit(1);
+        }
+        for (i = 0; i < elems; i++)
+            p->next[i] = (uint32_t)i;
+        for (i = elems - 1; i > 0; i--) {
+            j = rng_below(i);
+            tmp = p->next[i];
+            p->next[i] = p->next[j];
+            p->next[j] = tmp;
+        }
+    }
+}
+
+/* next_address - Produce the next address of stream p */
+static inline uint64_t next_address(pattern_t *p, const trace_spec_t *spec)
+{
+    uint64_t elems = spec->footprint / spec->block;
+    uint64_t off;
+
+    switch (p->kind) {
+    case PAT_SEQ:
+        off = p->pos;
+        p->pos += spec->size;
+        if (p->pos >= spec->footprint)
+            p->pos = 0;
+        return p->region + off;
+    case PAT_STRIDE:
+        off = p->pos;
+        p->pos += spec->stride;
+        if (p->pos >= spec->footprint)
+            p->pos = (p->pos + spec->size) % spec->stride;
+        return p->region + off;
+    case PAT_RANDOM:
+        return p->region + rng_below(elems) * spec->block;
+    case PAT_ZIPF:
+        /* scatter the ranks so the hot blocks don't share sets */
+        off = mulmod(zipf_sample(p, elems) - 1, p->zipf_scatter, elems);
+        return p->region + off * spec->block;
+    case PAT_CHASE:
+        p->pos = p->next[p->pos];
+        return p->region + p->pos * spec->block;
+    }
+    return p->region;
+}
+
+/* Lowercase hex digits for the text writer */
+static const char hexdigits[] = "0123456789abcdef";
+
+/* put_record - Append one text trace line to buf, returns its length */
+static inline int put_record(char *buf, char op, uint64_t addr, unsigned int size)
+{
+    char tmp[16];
+    int n = 0, len = 0;
+
+    buf[len++] = ' ';
+    buf[len++] = op;
+    buf[len++] = ' ';
+    do {
+        tmp[n++] = hexdigits[addr & 0xf];
+        addr >>= 4;
+    } while (addr);
+    while (n)
+        buf[len++] = tmp[--n];
+    buf[len++] = ',';
+    len += sprintf(buf + len, "%u", size);
+    buf[len++] = '\n';
+    return len;
+}
+
+/*
+ * generate - Write spec->count accesses to out. Returns 0 on success.
+ */
+static int generate(const trace_spec_t *spec, int binary, FILE *out)
+{
+    pattern_t pats[MAX_PATTERNS];
+    unsigned int total_weight = 0, ratio_total;
+    unsigned long long i;
+    char *buf;
+    size_t used = 0;
+    int npats, k;
+
+    npats = parse_patterns(spec->patterns, pats);
+    if (npats <= 0) {
+        fprintf(stderr, "synthtrace: bad pattern list \"%s\"\n", spec->patterns);
+        return 1;
+    }
+    if (spec->block == 0 || spec->footprint < spec->block || spec->stride == 0) {
+        fprintf(stderr, "synthtrace: footprint, stride and block must be positive\n");
+        return 1;
+    }
+    ratio_total = spec->ratio[0] + spec->ratio[1] + spec->ratio[2];
+    if (ratio_total == 0) {
+        fprintf(stderr, "synthtrace: L:S:M ratio must not be all zero\n");
+        return 1;
+    }
+
+    rng_state = spec->seed;
+    zipf_exponent = spec->zipf;
+    for (k = 0; k < npats; k++) {
+        init_pattern(&pats[k], k, spec);
+        total_weight += pats[k].weight;
+    }
+    if (total_weight == 0) {
+        fprintf(stderr, "synthtrace: pattern weights must not be all zero\n");
+        return 1;
+    }
+
+    buf = malloc(OUTBUF_SIZE);
+    if (!buf) {
+        fprintf(stderr, "synthtrace: out of memory\n");
+        return 1;
+    }
+
+    if (binary)
+        fwrite(TRACE_MAGIC, 1, TRACE_MAGIC_LEN, out);
+
+    for (i = 0; i < spec->count; i++) {
+        pattern_t *p = &pats[0];
+        unsigned int pick, r;
+        char op;
+        uint64_t addr;
+
+        if (npats > 1) {
+            pick = (unsigned int)rng_below(total_weight);
+            for (k = 0; pick >= pats[k].weight; k++)
+                pick -= pats[k].weight;
+            p = &pats[k];
+        }
+        addr = next_address(p, spec);
+
+        r = (unsigned int)rng_below(ratio_total);
+        op = r < spec->ratio[0] ? 'L' : (r < spec->ratio[0] + spec->ratio[1] ? 'S' : 'M');
+
+        if (binary) {
+            trace_store_le64((unsigned char *)buf + used, TRACE_PACK(op, spec->size, addr));
+            used += sizeof(uint64_t);
+        } else {
+            used += put_record(buf + used, op, addr, spec->size);
+        }
+        if (used > OUTBUF_SIZE - 64) {
+            if (fwrite(buf, 1, used, out) != used) {
+                perror("synthtrace");
+                return 1;
+            }
+            used = 0;
+        }
+    }
+    if (used && fwrite(buf, 1, used, out) != used) {
+        perror("synthtrace");
+        return 1;
+    }
+
+    for (k = 0; k < npats; k++)
+        free(pats[k].next);
+    free(buf);
+    return 0;
+}
+
+/*
+ * usage - Print usage info
+ */
+static void usage(char *argv[])
+{
+    printf("Usage: %s [-hlB] [-c <preset>] [-p <patterns>] [-n <count>] [-s <seed>]\n"
+           "       [-w <bytes>] [-S <stride>] [-a <size>] [-k <block>] [-z <exp>]\n"
+           "       [-r <L:S:M>] [-o <file>]\n", argv[0]);
+    printf("Options:\n");
+    printf("  -h            Print this help message.\n");
+    printf("  -l            List the named benchmark corpus.\n");
+    printf("  -c <preset>   Start from a named corpus entry (other options override it).\n");
+    printf("  -p <list>     Patterns seq, stride, random, zipf, chase; mix as name:weight,...\n");
+    printf("  -n <count>    Number of accesses (k, M and G suffixes are powers of 1000).\n");
+    printf("  -s <seed>     Random seed.\n");
+    printf("  -w <bytes>    Footprint of each pattern (K, M and G suffixes are powers of 1024).\n");
+    printf("  -S <bytes>    Stride of the stride pattern.\n");
+    printf("  -a <bytes>    Access size written to each record.\n");
+    printf("  -k <bytes>    Element size of the random, zipf and chase patterns.\n");
+    printf("  -z <exp>      Zipf exponent.\n");
+    printf("  -r <L:S:M>    Relative weights of loads, stores and modifies.\n");
+    printf("  -B            Write the binary format instead of text.\n");
+    printf("  -o <file>     Output file (default stdout).\n");
+    printf("\nExamples:\n");
+    printf("  %s -c small-mixed -o small.trace\n", argv[0]);
+    printf("  %s -p zipf:80,seq:20 -n 100000000 -w 64M -r 70:20:10 -B -o big.bin\n", argv[0]);
+}
+
+/* parse_count - strtoull with decimal k/M/G suffixes (powers of 1000) */
+static unsigned long long parse_count(const char *s)
+{
+    char *end;
+    unsigned long long v = strtoull(s, &end, 0);
+
+    switch (*end) {
+    case 'k': case 'K': return v * 1000ULL;
+    case 'm': case 'M': return v * 1000000ULL;
+    case 'g': case 'G': return v * 1000000000ULL;
+    }
+    return v;
+}
+
+/* parse_bytes - strtoull with binary K/M/G suffixes (powers of 1024) */
+static unsigned long long parse_bytes(const char *s)
+{
+    char *end;
+    unsigned long long v = strtoull(s, &end, 0);
+
+    switch (*end) {
+    case 'k': case 'K': return v << 10;
+    case 'm': case 'M': return v << 20;
+    case 'g': case 'G': return v << 30;
+    }
+    return v;
+}
+
+/*
+ * main - Without -c, the options start from the small-mixed preset
+ */
+int main(int argc, char *argv[])
+{
+    trace_spec_t spec = presets[NUM_PRESETS - 1].spec;
+    trace_spec_t over;
+    char *outfile = NULL;
+    int binary = 0, c, status;
+    unsigned int k;
+    FILE *out = stdout;
+    /* Remember which options were given so they can override a preset */
+    int set_n = 0, set_s = 0, set_w = 0, set_S = 0, set_a = 0, set_k = 0,
+        set_z = 0, set_r = 0, set_p = 0;
+
+    memset(&over, 0, sizeof(over));
+    while ((c = getopt(argc, argv, "hlBc:p:n:s:w:S:a:k:z:r:o:")) != -1) {
+        switch (c) {
+        case 'l':
+            for (k = 0; k < NUM_PRESETS; k++)
+                printf("%-14s %s\n", presets[k].name, presets[k].description);
+            exit(0);
+        case 'c':
+            for (k = 0; k < NUM_PRESETS; k++) {
+                if (!strcmp(optarg, presets[k].name))
+                    break;
+            }
+            if (k == NUM_PRESETS) {
+                fprintf(stderr, "synthtrace: no preset named \"%s\" (see -l)\n", optarg);
+                exit(1);
+            }
+            spec = presets[k].spec;
+            break;
+        case 'p':
+            strncpy(over.patterns, optarg, sizeof(over.patterns) - 1);
+            set_p = 1;
+            break;
+        case 'n':
+            over.count = parse_count(optarg);
+            set_n = 1;
+            break;
+        case 's':
+            over.seed = strtoull(optarg, NULL, 0);
+            set_s = 1;
+            break;
+        case 'w':
+            over.footprint = parse_bytes(optarg);
+            set_w = 1;
+            break;
+        case 'S':
+            over.stride = (unsigned int)parse_bytes(optarg);
+            set_S = 1;
+            break;
+        case 'a':
+            over.size = atoi(optarg);
+            set_a = 1;
+            break;
+        case 'k':
+            over.block = (unsigned int)parse_bytes(optarg);
+            set_k = 1;
+            break;
+        case 'z':
+            over.zipf = atof(optarg);
+            set_z = 1;
+            break;
+        case 'r':
+            if (sscanf(optarg, "%u:%u:%u", &over.ratio[0], &over.ratio[1], &over.ratio[2]) != 3) {
+                fprintf(stderr, "synthtrace: -r expects L:S:M\n");
+                exit(1);
+            }
+            set_r = 1;
+            break;
+        case 'B':
+            binary = 1;
+            break;
+        case 'o':
+            outfile = optarg;
+            break;
+        case 'h':
+            usage(argv);
+            exit(0);
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+
+    if (set_n) spec.count = over.count;
+    if (set_s) spec.seed = over.seed;
+    if (set_w) spec.footprint = over.footprint;
+    if (set_S) spec.stride = over.stride;
+    if (set_a) spec.size = over.size;
+    if (set_k) spec.block = over.block;
+    if (set_z) spec.zipf = over.zipf;
+    if (set_p) strcpy(spec.patterns, over.patterns);
+    if (set_r) memcpy(spec.ratio, over.ratio, sizeof(spec.ratio));
+
+    if (outfile) {
+        out = fopen(outfile, binary ? "wb" : "w");
+        if (!out) {
+            perror(outfile);
+            exit(1);
+        }
+    }
+
+    status = generate(&spec, binary, out);
+    if (out != stdout)
+        fclose(out);
+    return status;
+}
@@ -0,0 +1,128 @@
+#!/usr/bin/env python
+#
+# test-csimd.py - Checks the csimd protocol end to end. It starts
+#     ./csimd on a private socket, sends it "sim ... trace=<path>" and
+#     "sim ... batch" requests for the bundled traces, compares every
+#     reply's hits, misses and evictions with ./csim-ref on the same
+#     trace, checks that malformed requests get an error line, and
+#     shuts the server down. Exits non-zero on the first disagreement.
+#
+from __future__ import print_function
+import glob
+import optparse
+import os
+import socket
+import subprocess
+import sys
+import time
+
+# (s, E, b), csim-ref needs s >= 1
+GEOMETRIES = [
+    (1, 1, 1),
+    (4, 2, 4),
+    (2, 4, 3),
+    (5, 1, 5),
+    (3, 16, 4),
+]
+
+#
+# connect - Connect to the server, returns a line-buffered read/write stream
+#
+def connect(path):
+    sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    sock.connect(path)
+    return sock, sock.makefile("rw")
+
+#
+# request - Send lines and read back the one reply line
+#
+def request(stream, lines):
+    for line in lines:
+        stream.write(line)
+    stream.flush()
+    return stream.readline().strip()
+
+#
+# reference - hits, misses and evictions from csim-ref's summary line
+#
+def reference(trace, s, E, b):
+    out = subprocess.check_output(["./csim-ref", "-s", str(s), "-E", str(E),
+                                   "-b", str(b), "-t", trace]).decode()
+    for line in out.splitlines():
+        if line.startswith("hits:"):
+            return tuple(int(field.split(":")[1]) for field in line.split()[:3])
+    raise RuntimeError("no summary line from csim-ref on %s" % trace)
+
+#
+# counts - hits, misses and evictions from an "ok ..." reply
+#
+def counts(reply):
+    fields = reply.split()
+    if not fields or fields[0] != "ok":
+        return None
+    return tuple(int(field.split(":")[1]) for field in fields[1:4])
+
+def main():
+    p = optparse.OptionParser()
+    p.add_option("-S", "--socket", default=".csimd-test.sock",
+                 help="Socket for the server under test")
+    p.add_option("-j", "--workers", type="int", default=2,
+                 help="Workers to start csimd with (default 2)")
+    opts, _ = p.parse_args()
+
+    if os.path.exists(opts.socket):
+        os.unlink(opts.socket)
+    server = subprocess.Popen(["./csimd", "-S", opts.socket, "-j", str(opts.workers)],
+                              stdout=subprocess.PIPE)
+    server.stdout.readline()  # "csimd: listening on ..."
+
+    failures = 0
+    sock, stream = connect(opts.socket)
+    for trace in sorted(glob.glob("traces/*.trace")):
+        records = open(trace).read()
+        for (s, E, b) in GEOMETRIES:
+            want = reference(trace, s, E, b)
+            by_path = request(stream, ["sim s=%d E=%d b=%d trace=%s\n" % (s, E, b, trace)])
+            by_batch = request(stream, ["sim s=%d E=%d b=%d batch\n" % (s, E, b),
+                                        records, "end\n"])
+            for kind, reply in (("trace", by_path), ("batch", by_batch)):
+                if counts(reply) != want:
+                    print("FAIL %s s=%d E=%d b=%d %s: csim-ref %s, csimd %s" %
+                          (trace, s, E, b, kind, want, reply))
+                    failures += 1
+        print("%-20s %d geometries ok" % (trace, len(GEOMETRIES)))
+
+    for bad in ["sim s=4 E=0 b=4 trace=traces/yi.trace\n",
+                "sim s=4 E=1 b=4 colour=red trace=traces/yi.trace\n",
+                "sim s=4 E=1 b=4 trace=traces/missing.trace\n",
+                "frobnicate\n"]:
+        reply = request(stream, [bad])
+        if not reply.startswith("error "):
+            print("FAIL %r: expected an error, got %s" % (bad.strip(), reply))
+            failures += 1
+    if not request(stream, ["stats\n"]).startswith("ok jobs:"):
+        print("FAIL stats")
+        failures += 1
+    sock.close()
+
+    # an idle client must not hold up the shutdown
+    idle, _ = connect(opts.socket)
+    sock, stream = connect(opts.socket)
+    request(stream, ["shutdown\n"])
+    sock.close()
+    deadline = time.time() + 10
+    while server.poll() is None and time.time() < deadline:
+        time.sleep(0.05)
+    idle.close()
+    if server.poll() is None:
+        print("FAIL csimd still running 10 s after shutdown")
+        server.kill()
+        failures += 1
+
+    if failures:
+        print("%d check(s) failed" % failures)
+        sys.exit(1)
+    print("csimd agrees with csim-ref")
+
+if __name__ == "__main__":
+    main()
@@ -3,6 +3,7 @@
  *     student's transpose functions and records the results for their
  *     official submitted version as well.
  */
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -11,6 +12,8 @@
 #include <signal.h>
 #include <getopt.h>
 #include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include "cachelab.h"
 #include <sys/wait.h> // fir WEXITSTATUS
 #include <limits.h> // for INT_MAX
@@ -32,6 +35,8 @@ extern int func_counter;
 /* Globals set on the command line */
 static int M = 0;
 static int N = 0;
+static char *csimd_socket = NULL; /* -S: simulate on this csimd server */
+static pid_t workers[MAX_TRANS_FUNCS]; /* running -j workers, 0 once reaped */
 
 /* The correctness and performance for the submitted transpose function */
 struct results {
@@ -41,132 +46,404 @@ struct results {
 };
 static struct results results = {-1, 0, INT_MAX};
 
-/* 
- * eval_perf - Evaluate the performance of the registered transpose functions
+/* What a single function evaluation reports back to eval_perf() */
+struct eval_result {
+    int correct;
+    unsigned int hits;
+    unsigned int misses;
+    unsigned int evictions;
+};
+
+/*
+ * csimd_connect - Connect to the csimd server given with -S. Returns a
+ *     stream to send one request on, or NULL if nothing is listening.
  */
-void eval_perf(unsigned int s, unsigned int E, unsigned int b)
+static FILE *csimd_connect(void)
 {
-    int i,flag;
-    unsigned int len, hits, misses, evictions;
-    unsigned long long int marker_start, marker_end, addr;
-    char buf[1000], cmd[255];
-    char filename[128];
+    struct sockaddr_un addr;
+    int fd;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, csimd_socket, sizeof(addr.sun_path) - 1);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return NULL;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return NULL;
+    }
+    return fdopen(fd, "w");
+}
 
-    registerFunctions(); 
+/*
+ * eval_func - Validate function i, generate and filter its memory trace,
+ *     and run it through the reference simulator. Every file the
+ *     evaluation touches is suffixed with the function number, and the
+ *     simulator results are read from its stdout rather than from
+ *     .csim_results, so several evaluations can run at the same time.
+ *     With -S the filtered trace is streamed to csimd as it is written
+ *     instead, so no simulator process is started for the other
+ *     functions. csimd runs the student's cachesim.c, so the submission
+ *     is still graded by csim-ref, and any disagreement is reported.
+ *     Returns 0 on success, -1 if the function failed validation.
+ */
+static int eval_func(int i, unsigned int s, unsigned int E, unsigned int b,
+                     struct eval_result *res)
+{
+    int flag;
+    unsigned int len;
+    unsigned long long int marker_start, marker_end, addr;
+    char buf[1000], cmd[512];
+    char tracename[128], markername[128], filename[128];
 
-    /* Open the complete trace file */
     FILE* full_trace_fp;  
     FILE* part_trace_fp; 
+    FILE* sim_fp = NULL;
+    struct eval_result served;
 
-    /* Evaluate the performance of each registered transpose function */
+    memset(res, 0, sizeof(*res));
+    sprintf(tracename, "trace.tmp.%d", i);
+    sprintf(markername, ".marker.%d", i);
 
-    for (i=0; i<func_counter; i++) {
-        if (strcmp(func_list[i].description, SUBMIT_DESCRIPTION) == 0 )
-            results.funcid = i; /* remember which function is the submission */
+    printf("\nFunction %d (%d total)\nStep 1: Validating and generating memory traces\n",i,func_counter);
+    fflush(stdout);
+    /* Use valgrind to generate the trace */
+
+    sprintf(cmd, "valgrind --tool=lackey --trace-mem=yes --log-fd=1 -v ./tracegen -M %d -N %d -F %d -m %s > %s",
+            M, N, i, markername, tracename);
+    flag=WEXITSTATUS(system(cmd));
+    if (0!=flag) {
+        printf("Validation error at function %d! Run ./tracegen -M %d -N %d -F %d for details.\nSkipping performance evaluation for this function.\n",flag-1,M,N,i);      
+        unlink(tracename);
+        unlink(markername);
+        return -1;
+    }
 
+    /* Get the start and end marker addresses */
+    FILE* marker_fp = fopen(markername, "r");
+    assert(marker_fp);
+    fscanf(marker_fp, "%llx %llx", &marker_start, &marker_end);
+    fclose(marker_fp);
+    unlink(markername);
 
-        printf("\nFunction %d (%d total)\nStep 1: Validating and generating memory traces\n",i,func_counter);
-        /* Use valgrind to generate the trace */
+    res->correct = 1;
 
-        sprintf(cmd, "valgrind --tool=lackey --trace-mem=yes --log-fd=1 -v ./tracegen -M %d -N %d -F %d  > trace.tmp", M, N,i);
-        flag=WEXITSTATUS(system(cmd));
-        if (0!=flag) {
-            printf("Validation error at function %d! Run ./tracegen -M %d -N %d -F %d for details.\nSkipping performance evaluation for this function.\n",flag-1,M,N,i);      
-            continue;
+    full_trace_fp = fopen(tracename, "r");
+    assert(full_trace_fp);
+
+
+    /* Filtered trace for each transpose function goes in a separate file */
+    sprintf(filename, "trace.f%d", i);
+    part_trace_fp = fopen(filename, "w");
+    assert(part_trace_fp);
+
+    if (csimd_socket != NULL) {
+        sim_fp = csimd_connect();
+        if (sim_fp != NULL)
+            fprintf(sim_fp, "sim s=%u E=%u b=%u batch\n", s, E, b);
+        else
+            printf("Warning: csimd is not listening on %s, using csim-ref\n", csimd_socket);
+    }
+
+    /* Locate trace corresponding to the trans function */
+    flag = 0;
+    while (fgets(buf, 1000, full_trace_fp) != NULL) {
+
+        /* We are only interested in memory access instructions */
+        if (buf[0]==' ' && buf[2]==' ' &&
+            (buf[1]=='S' || buf[1]=='M' || buf[1]=='L' )) {
+            sscanf(buf+3, "%llx,%u", &addr, &len);
+    
+            /* If start marker found, set flag */
+            if (addr == marker_start)
+                flag = 1;
+
+            /* Valgrind creates many spurious accesses to the
+               stack that have nothing to do with the students
+               code. At the moment, we are ignoring all stack
+               accesses by using the simple filter of recording
+               accesses to only the low 32-bit portion of the
+               address space. At some point it would be nice to
+               try to do more informed filtering so that would
+               eliminate the valgrind stack references while
+               include the student stack references. */
+            if (flag && addr < 0xffffffff) {
+                fputs(buf, part_trace_fp);
+                if (sim_fp != NULL)
+                    fputs(buf, sim_fp);
+            }
+
+            /* if end marker found, stop copying */
+            if (addr == marker_end) {
+                flag = 0;
+                break;
+            }
         }
+    }
+    fclose(part_trace_fp);
+    fclose(full_trace_fp);
+    unlink(tracename);
 
-        /* Get the start and end marker addresses */
-        FILE* marker_fp = fopen(".marker", "r");
-        assert(marker_fp);
-        fscanf(marker_fp, "%llx %llx", &marker_start, &marker_end);
-        fclose(marker_fp);
+    /* Run the reference simulator, reading its summary line from a pipe */
+    printf("Step 2: Evaluating performance of func %d (s=%d, E=%d, b=%d)\n", i, s, E, b);
+    fflush(stdout);
+    if (sim_fp != NULL) {
+        /* csimd replies with a single "ok hits:... misses:... evictions:..." line */
+        FILE* reply_fp;
+
+        fputs("end\n", sim_fp);
+        fflush(sim_fp);
+        reply_fp = fdopen(dup(fileno(sim_fp)), "r");
+        assert(reply_fp);
+        flag = fgets(buf, 1000, reply_fp) != NULL &&
+            sscanf(buf, "ok hits:%u misses:%u evictions:%u",
+                   &res->hits, &res->misses, &res->evictions) == 3;
+        fclose(reply_fp);
+        fclose(sim_fp);
+        if (!flag)
+            printf("Error from csimd: %s", buf);
+        assert(flag);
+        if (i != results.funcid)
+            return 0;
+        /* Grading never depends on the simulator under test */
+        served = *res;
+    }
+    sprintf(cmd, "./csim-ref -s %u -E %u -b %u -t trace.f%d", s, E, b, i);
+    FILE* in_fp = popen(cmd, "r");
+    assert(in_fp);
+    flag = 0;
+    while (fgets(buf, 1000, in_fp) != NULL) {
+        if (sscanf(buf, "hits:%u misses:%u evictions:%u",
+                   &res->hits, &res->misses, &res->evictions) == 3)
+            flag = 1;
+    }
+    pclose(in_fp);
+    assert(flag);
+    if (sim_fp != NULL && (served.hits != res->hits || served.misses != res->misses ||
+                           served.evictions != res->evictions))
+        printf("Warning: csimd gave hits:%u misses:%u evictions:%u for func %d, "
+               "grading with csim-ref's\n", served.hits, served.misses, served.evictions, i);
+    return 0;
+}
 
+/*
+ * record_result - Copy the result for function i into func_list and
+ *     remember the submission's numbers.
+ */
+static void record_result(int i, struct eval_result *res)
+{
+    if (!res->correct)
+        return;
+
+    func_list[i].correct = 1;
+    func_list[i].num_hits = res->hits;
+    func_list[i].num_misses = res->misses;
+    func_list[i].num_evictions = res->evictions;
+    printf("func %u (%s): hits:%u, misses:%u, evictions:%u\n",
+           i, func_list[i].description, res->hits, res->misses, res->evictions);
+
+    /* If it is transpose_submit(), record correctness and number of misses */
+    if (results.funcid == i) {
+        results.correct = 1;
+        results.misses = res->misses;
+    }
+}
 
-        func_list[i].correct=1;
+/*
+ * kill_workers - Kill and reap every evaluation worker still running,
+ *     so none is left behind when the parent exits on an error.
+ */
+static void kill_workers(void)
+{
+    int i;
 
-        /* Save the correctness of the transpose submission */
-        if (results.funcid == i ) {
-            results.correct = 1;
+    for (i = 0; i < MAX_TRANS_FUNCS; i++) {
+        if (workers[i] > 0) {
+            kill(workers[i], SIGKILL);
+            waitpid(workers[i], NULL, 0);
+            workers[i] = 0;
         }
+    }
+}
+
+/*
+ * reap_worker - Wait for one evaluation worker to exit and collect its
+ *     result from the pipe it wrote to. Returns the number of workers
+ *     still running.
+ */
+static int reap_worker(int *fds, int running)
+{
+    int i, status;
+    struct eval_result res;
+    pid_t pid = wait(&status);
+
+    if (pid < 0)
+        return 0;
+    for (i = 0; i < func_counter; i++) {
+        if (workers[i] != pid)
+            continue;
+        memset(&res, 0, sizeof(res));
+        if (read(fds[i], &res, sizeof(res)) != sizeof(res))
+            res.correct = 0;
+        close(fds[i]);
+        workers[i] = 0;
+        record_result(i, &res);
+        break;
+    }
+    return running - 1;
+}
 
-        full_trace_fp = fopen("trace.tmp", "r");
-        assert(full_trace_fp);
+/* 
+ * eval_perf - Evaluate the performance of the registered transpose
+ *     functions, running up to jobs evaluations at once. Each worker is
+ *     a forked child that hands its eval_result back through a pipe.
+ */
+void eval_perf(unsigned int s, unsigned int E, unsigned int b, int jobs)
+{
+    int i, running = 0;
+    int fds[MAX_TRANS_FUNCS], pipefd[2];
+    unsigned int timeout;
+    struct eval_result res;
 
+    registerFunctions(); 
 
-        /* Filtered trace for each transpose function goes in a separate file */
-        sprintf(filename, "trace.f%d", i);
-        part_trace_fp = fopen(filename, "w");
-        assert(part_trace_fp);
-    
-        /* Locate trace corresponding to the trans function */
-        flag = 0;
-        while (fgets(buf, 1000, full_trace_fp) != NULL) {
-
-            /* We are only interested in memory access instructions */
-            if (buf[0]==' ' && buf[2]==' ' &&
-                (buf[1]=='S' || buf[1]=='M' || buf[1]=='L' )) {
-                sscanf(buf+3, "%llx,%u", &addr, &len);
-        
-                /* If start marker found, set flag */
-                if (addr == marker_start)
-                    flag = 1;
-
-                /* Valgrind creates many spurious accesses to the
-                   stack that have nothing to do with the students
-                   code. At the moment, we are ignoring all stack
-                   accesses by using the simple filter of recording
-                   accesses to only the low 32-bit portion of the
-                   address space. At some point it would be nice to
-                   try to do more informed filtering so that would
-                   eliminate the valgrind stack references while
-                   include the student stack references. */
-                if (flag && addr < 0xffffffff) {
-                    fputs(buf, part_trace_fp);
-                }
-
-                /* if end marker found, close trace file */
-                if (addr == marker_end) {
-                    flag = 0;
-                    fclose(part_trace_fp);
-                    break;
-                }
-            }
+    for (i=0; i<func_counter; i++) {
+        if (strcmp(func_list[i].description, SUBMIT_DESCRIPTION) == 0 )
+            results.funcid = i; /* remember which function is the submission */
+    }
+
+    /* A single job runs in-process, exactly as it always has */
+    if (jobs <= 1) {
+        for (i=0; i<func_counter; i++) {
+            if (eval_func(i, s, E, b, &res) == 0)
+                record_result(i, &res);
         }
-        fclose(full_trace_fp);
-
-        /* Run the reference simulator */
-        printf("Step 2: Evaluating performance (s=%d, E=%d, b=%d)\n", s, E, b);
-        char cmd[255];
-        sprintf(cmd, "./csim-ref -s %u -E %u -b %u -t trace.f%d > /dev/null", 
-                s, E, b, i);
-        system(cmd);
-    
-        /* Collect results from the reference simulator */
-        FILE* in_fp = fopen(".csim_results","r");
-        assert(in_fp);
-        fscanf(in_fp, "%u %u %u", &hits, &misses, &evictions);
-        fclose(in_fp);
-        func_list[i].num_hits = hits;
-        func_list[i].num_misses = misses;
-        func_list[i].num_evictions = evictions;
-        printf("func %u (%s): hits:%u, misses:%u, evictions:%u\n",
-               i, func_list[i].description, hits, misses, evictions);
-    
-        /* If it is transpose_submit(), record number of misses */
-        if (results.funcid == i) {
-            results.misses = misses;
+        return;
+    }
+
+    for (i=0; i<func_counter; i++) {
+        if (running == jobs)
+            running = reap_worker(fds, running);
+
+        if (pipe(pipefd) < 0) {
+            perror("pipe");
+            kill_workers();
+            exit(1);
+        }
+        /* A child doesn't inherit the pending alarm, so hand it the
+           time the parent has left */
+        timeout = alarm(0);
+        alarm(timeout);
+        /* reap_worker() prints, so flush before every fork or the
+           child inherits and re-prints the parent's buffered output */
+        fflush(stdout);
+        workers[i] = fork();
+        if (workers[i] < 0) {
+            workers[i] = 0;
+            perror("fork");
+            kill_workers();
+            exit(1);
         }
+        if (workers[i] == 0) {
+            /* Child: the siblings aren't its to kill, and on a timeout
+               it just dies and leaves the report to the parent. The
+               result fits in one atomic pipe write */
+            memset(workers, 0, sizeof(workers));
+            signal(SIGALRM, SIG_DFL);
+            alarm(timeout);
+            close(pipefd[0]);
+            eval_func(i, s, E, b, &res);
+            if (write(pipefd[1], &res, sizeof(res)) != sizeof(res))
+                _exit(1);
+            close(pipefd[1]);
+            fflush(stdout);
+            _exit(0);
+        }
+        close(pipefd[1]);
+        fds[i] = pipefd[0];
+        running++;
     }
-  
+
+    while (running > 0)
+        running = reap_worker(fds, running);
+}
+
+/*
+ * check_kernel - Check one element size of transpose_generic() on the
+ *     N x M matrix, and of transpose_square_inplace() on an N x N one,
+ *     against a naive element-by-element transpose. Returns 1 if both
+ *     match, 0 otherwise.
+ */
+static int check_kernel(size_t size, int M, int N)
+{
+    unsigned char *A, *B, *C;
+    size_t bytes = size * M * N;
+    int i, j, ok;
+
+    if (bytes < size * N * N)
+        bytes = size * N * N;
+    A = malloc(bytes);
+    B = malloc(bytes);
+    C = malloc(bytes);
+    assert(A && B && C);
+
+    /* Every byte differs from its neighbours, so a misplaced byte
+       within an element shows up as well as a misplaced element */
+    for (i = 0; i < (int)bytes; i++)
+        A[i] = (unsigned char)(i * 131 + 7);
+
+    memset(B, 0, bytes);
+    transpose_generic(size, M, N, A, B);
+    for (i = 0; i < N; i++)
+        for (j = 0; j < M; j++)
+            memcpy(C + size * ((size_t)j * N + i), A + size * ((size_t)i * M + j), size);
+    ok = memcmp(B, C, size * M * N) == 0;
+
+    memcpy(B, A, size * N * N);
+    transpose_square_inplace(size, N, B);
+    for (i = 0; i < N; i++)
+        for (j = 0; j < N; j++)
+            memcpy(C + size * ((size_t)j * N + i), A + size * ((size_t)i * N + j), size);
+    ok = ok && memcmp(B, C, size * N * N) == 0;
+
+    free(A);
+    free(B);
+    free(C);
+    return ok;
+}
+
+/*
+ * check_kernels - The int transpose functions only ever run the 4 byte
+ *     generic kernel, so check every element size here, like
+ *     correctTrans() checks the registered functions. Returns 1 if
+ *     every size is correct, 0 otherwise.
+ */
+static int check_kernels(int M, int N)
+{
+    static const size_t sizes[] = {1, 2, 4, 8, 16};
+    int i, ok, all_ok = 1;
+
+    printf("Generic kernels (%dx%d and %dx%d):", N, M, N, N);
+    for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+        ok = check_kernel(sizes[i], M, N);
+        printf(" %zu-byte=%s", sizes[i], ok ? "ok" : "FAILED");
+        all_ok = all_ok && ok;
+    }
+    printf("\n");
+    return all_ok;
 }
 
 /*
  * usage - Print usage info
  */
 void usage(char *argv[]){
-    printf("Usage: %s [-h] -M <rows> -N <cols>\n", argv[0]);
+    printf("Usage: %s [-h] [-j <jobs>] [-S <socket>] -M <rows> -N <cols>\n", argv[0]);
     printf("Options:\n");
     printf("  -h          Print this help message.\n");
+    printf("  -j <jobs>   Functions to evaluate at once (default: online CPUs)\n");
+    printf("  -S <socket> Simulate on the csimd server on this socket (the submission\n");
+    printf("              is still graded by csim-ref)\n");
     printf("  -M <rows>   Number of matrix rows (max %d)\n", MAXN);
     printf("  -N <cols>   Number of  matrix columns (max %d)\n", MAXN);
     printf("Example: %s -M 8 -N 8\n", argv[0]);       
@@ -179,6 +456,7 @@ void sigsegv_handler(int signum){
     printf("Error: Segmentation Fault.\n");
     printf("TEST_TRANS_RESULTS=0:0\n");
     fflush(stdout);
+    kill_workers();
     exit(1);
 }
 
@@ -189,6 +467,7 @@ void sigalrm_handler(int signum){
     printf("Error: Program timed out.\n");
     printf("TEST_TRANS_RESULTS=0:0\n");
     fflush(stdout);
+    kill_workers();
     exit(1);
 }
 
@@ -198,8 +477,10 @@ void sigalrm_handler(int signum){
 int main(int argc, char* argv[])
 {
     char c;
+    int jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int kernels_ok;
 
-    while ((c = getopt(argc,argv,"M:N:h")) != -1) {
+    while ((c = getopt(argc,argv,"M:N:j:S:h")) != -1) {
         switch(c) {
         case 'M':
             M = atoi(optarg);
@@ -207,6 +488,12 @@ int main(int argc, char* argv[])
         case 'N':
             N = atoi(optarg);
             break;
+        case 'j':
+            jobs = atoi(optarg);
+            break;
+        case 'S':
+            csimd_socket = optarg;
+            break;
         case 'h':
             usage(argv);
             exit(0);
@@ -242,8 +529,18 @@ int main(int argc, char* argv[])
     /* Time out and give up after a while */
     alarm(120);
 
+    /* Check every element size of the generic kernels */
+    kernels_ok = check_kernels(M, N);
+
     /* Check the performance of the student's transpose function */
-    eval_perf(5, 1, 5);
+    eval_perf(5, 1, 5, jobs);
+
+    /* The submission shares these kernels' file, so a broken kernel
+       fails the run however the submission itself did */
+    if (!kernels_ok) {
+        printf("\nError: a generic transpose kernel is incorrect\n");
+        results.correct = 0;
+    }
   
     /* Emit the results for this particular test */
     if (results.funcid == -1) {
@@ -257,5 +554,5 @@ int main(int argc, char* argv[])
                results.funcid, results.correct, results.misses);
         printf("\nTEST_TRANS_RESULTS=%d:%d\n", results.correct, results.misses);
     }
-    return 0;
+    return kernels_ok ? 0 : 1;
 }
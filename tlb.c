@@ -0,0 +1,144 @@
+/* Two-level data TLB model.
+ * Both levels are set-associative, indexed by virtual page number modulo the number of sets.
+ * The STLB is not inclusive of the L1: an L1 miss that hits the STLB fills the L1, and a walk
+ * fills both.
+ *
+ * Authors: Theodore Bieber (tjbieber), James Honicker (jlhonicker)
+*/
+#include "tlb.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Where each page table level lives, chosen far away from any trace addresses
+#define PAGE_TABLE_BASE 0x7f0000000000ULL
+#define PAGE_TABLE_LEVEL_SPAN 0x8000000000ULL
+
+// Sets up one level, returns 0 if the geometry doesn't divide evenly
+static int createLevel(tlbLevel *level, int entries, int ways) {
+	level->entries = entries;
+	level->ways = ways;
+	level->hits = 0;
+	level->misses = 0;
+	level->lines = NULL;
+	if(entries <= 0 || ways <= 0 || entries % ways != 0) {
+		return 0;
+	}
+	level->sets = entries / ways;
+	level->lines = (tlbEntry *) calloc(entries, sizeof(tlbEntry));
+	return 1;
+}
+
+tlb createTlb(int l1Entries, int l1Ways, int stlbEntries, int stlbWays, int pageBits) {
+	tlb theTlb;
+
+	theTlb.pageBits = pageBits;
+	// each level of an x86-64 page table translates 9 bits above the 4KB page offset
+	theTlb.walkLevels = 4 - (pageBits - 12) / 9;
+	theTlb.clock = 0;
+	theTlb.walks = 0;
+	theTlb.walkRefs = 0;
+	theTlb.walkLatency = WALK_LATENCY;
+	theTlb.walkHitLatency = WALK_HIT_LATENCY;
+	theTlb.walkCacheHits = 0;
+	theTlb.walkCacheMisses = 0;
+	theTlb.walkCacheEvictions = 0;
+
+	if(!createLevel(&theTlb.l1, l1Entries, l1Ways) ||
+			!createLevel(&theTlb.stlb, stlbEntries, stlbWays)) {
+		free(theTlb.l1.lines);
+		free(theTlb.stlb.lines);
+		theTlb.l1.entries = 0;
+	}
+	return theTlb;
+}
+
+/* Looks a page up in one level, updating its LRU state and statistics
+ * return: 1 on a hit, 0 on a miss
+*/
+static int lookupLevel(tlbLevel *level, unsigned long long vpn, unsigned long long clock) {
+	tlbEntry *set = &level->lines[(vpn % level->sets) * level->ways];
+	int waycounter;
+
+	for(waycounter = 0; waycounter < level->ways; waycounter++) {
+		if(set[waycounter].valid && set[waycounter].vpn == vpn) {
+			set[waycounter].lastUsed = clock;
+			level->hits++;
+			return 1;
+		}
+	}
+	level->misses++;
+	return 0;
+}
+
+// Puts a page in one level, replacing an empty entry or the least recently used one
+static void fillLevel(tlbLevel *level, unsigned long long vpn, unsigned long long clock) {
+	tlbEntry *set = &level->lines[(vpn % level->sets) * level->ways];
+	tlbEntry *victim = &set[0];
+	int waycounter;
+
+	for(waycounter = 0; waycounter < level->ways; waycounter++) {
+		if(!set[waycounter].valid) {
+			victim = &set[waycounter];
+			break;
+		}
+		if(set[waycounter].lastUsed < victim->lastUsed) {
+			victim = &set[waycounter];
+		}
+	}
+	victim->vpn = vpn;
+	victim->lastUsed = clock;
+	victim->valid = 1;
+}
+
+tlbResult_t translate(tlb *theTlb, unsigned long long address, unsigned long long *walkAddresses) {
+	unsigned long long vpn = address >> theTlb->pageBits;
+	int levelcounter;
+
+	theTlb->clock++;
+	if(lookupLevel(&theTlb->l1, vpn, theTlb->clock)) {
+		return TLB_L1_HIT;
+	}
+	if(lookupLevel(&theTlb->stlb, vpn, theTlb->clock)) {
+		fillLevel(&theTlb->l1, vpn, theTlb->clock);
+		return TLB_STLB_HIT;
+	}
+
+	// Walk from the root: the entry at each level is indexed by the address bits above it
+	theTlb->walks++;
+	theTlb->walkRefs += theTlb->walkLevels;
+	for(levelcounter = 0; levelcounter < theTlb->walkLevels; levelcounter++) {
+		int shift = 39 - 9 * levelcounter;
+		walkAddresses[levelcounter] = PAGE_TABLE_BASE + levelcounter * PAGE_TABLE_LEVEL_SPAN +
+			(address >> shift) * 8;
+	}
+	fillLevel(&theTlb->stlb, vpn, theTlb->clock);
+	fillLevel(&theTlb->l1, vpn, theTlb->clock);
+	return TLB_WALK;
+}
+
+void printTlb(tlb *theTlb) {
+	const char *pageName = theTlb->pageBits == 30 ? "1G" : (theTlb->pageBits == 21 ? "2M" : "4K");
+
+	printf("dTLB (%d entries, %d-way, %s pages) hits:%llu misses:%llu\n", theTlb->l1.entries,
+		theTlb->l1.ways, pageName, theTlb->l1.hits, theTlb->l1.misses);
+	printf("STLB (%d entries, %d-way) hits:%llu misses:%llu\n", theTlb->stlb.entries,
+		theTlb->stlb.ways, theTlb->stlb.hits, theTlb->stlb.misses);
+	// walk references that went through the data cache are kept out of the program's counts, and
+	// cost according to whether they hit it
+	if(theTlb->walkCacheHits + theTlb->walkCacheMisses > 0) {
+		printf("page walks:%llu walk_refs:%llu walk_cycles:%llu (%d per cache hit, %d per miss)\n",
+			theTlb->walks, theTlb->walkRefs, theTlb->walkCacheHits * theTlb->walkHitLatency +
+			theTlb->walkCacheMisses * theTlb->walkLatency, theTlb->walkHitLatency,
+			theTlb->walkLatency);
+		printf("walk cache hits:%llu misses:%llu evictions:%llu\n", theTlb->walkCacheHits,
+			theTlb->walkCacheMisses, theTlb->walkCacheEvictions);
+	} else {
+		printf("page walks:%llu walk_refs:%llu walk_cycles:%llu (%d per ref)\n", theTlb->walks,
+			theTlb->walkRefs, theTlb->walkRefs * theTlb->walkLatency, theTlb->walkLatency);
+	}
+}
+
+void freeTlb(tlb *theTlb) {
+	free(theTlb->l1.lines);
+	free(theTlb->stlb.lines);
+}
@@ -0,0 +1,77 @@
+/* Two-level data TLB model.
+ * An L1 dTLB backed by a second-level STLB, both set-associative with LRU replacement, for a single
+ * page size per run (4KB, 2MB or 1GB). An STLB miss walks the x86-64 style page table, whose
+ * entry addresses can be fed to the data cache so walks compete with the program for cache space.
+ *
+ * Authors: Theodore Bieber (tjbieber), James Honicker (jlhonicker)
+*/
+#ifndef TLB_H
+#define TLB_H
+
+// Most page table levels a walk touches (4KB pages)
+#define MAX_WALK_LEVELS 4
+// Default cycles per page walk reference (one that misses the data cache, with -W)
+#define WALK_LATENCY 20
+// Default cycles per page walk reference that hits the data cache, with -W
+#define WALK_HIT_LATENCY 4
+
+// Where a translation was found
+typedef enum {
+	TLB_L1_HIT,
+	TLB_STLB_HIT,
+	TLB_WALK
+} tlbResult_t;
+
+typedef struct {
+	unsigned long long vpn;
+	unsigned long long lastUsed;
+	int valid;
+} tlbEntry;
+
+// One TLB level
+typedef struct {
+	int entries;
+	int ways;
+	int sets; // entries / ways, need not be a power of two
+	tlbEntry *lines;
+	unsigned long long hits;
+	unsigned long long misses;
+} tlbLevel;
+
+typedef struct {
+	tlbLevel l1;
+	tlbLevel stlb;
+	int pageBits; // 12, 21 or 30
+	int walkLevels; // page table levels below the page size
+	unsigned long long clock; // LRU clock
+	unsigned long long walks;
+	unsigned long long walkRefs;
+	int walkLatency; // cycles per walk reference, or per one that misses the data cache
+	int walkHitLatency; // cycles per walk reference that hits the data cache
+	unsigned long long walkCacheHits; // of walkRefs, when they go to the data cache
+	unsigned long long walkCacheMisses;
+	unsigned long long walkCacheEvictions; // lines the walks evicted from the data cache
+} tlb;
+
+/* Builds the TLB
+ * Parameters:
+ *     l1Entries, l1Ways, stlbEntries, stlbWays: the geometry of each level
+ *     pageBits: log2 of the page size, 12, 21 or 30
+ * return: the TLB, with l1.entries == 0 if the geometry is invalid
+*/
+tlb createTlb(int l1Entries, int l1Ways, int stlbEntries, int stlbWays, int pageBits);
+
+/* Translates an address
+ * Parameters:
+ *     walkAddresses: on a walk, filled in with the walkLevels page table entry addresses
+ * return: which level had the translation
+*/
+tlbResult_t translate(tlb *theTlb, unsigned long long address, unsigned long long *walkAddresses);
+
+// Prints the TLB statistics
+void printTlb(tlb *theTlb);
+
+// Deallocates the TLB
+void freeTlb(tlb *theTlb);
+
+#endif /* TLB_H */
@@ -0,0 +1,42 @@
+/*
+ * tracefile.c - Reading binary traces, shared by csim and csimd
+ *
+ * See tracefile.h for the format.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "tracefile.h"
+
+/*
+ * trace_is_binary - Check whether a trace starts with TRACE_MAGIC. If it
+ *     does, the magic is consumed, otherwise the file is rewound for the
+ *     text reader.
+ */
+int trace_is_binary(FILE *fp)
+{
+    char magic[TRACE_MAGIC_LEN];
+
+    if (fread(magic, 1, TRACE_MAGIC_LEN, fp) == TRACE_MAGIC_LEN &&
+        !memcmp(magic, TRACE_MAGIC, TRACE_MAGIC_LEN))
+        return 1;
+    rewind(fp);
+    return 0;
+}
+
+/*
+ * trace_read_binary - Read up to max records after the magic, converting
+ *     each from little-endian in place on a big-endian host
+ */
+size_t trace_read_binary(FILE *fp, uint64_t *records, size_t max)
+{
+    size_t got = fread(records, sizeof(uint64_t), max, fp);
+    size_t i;
+
+    /* little-endian host, the records are already in its order */
+    if (trace_host_is_le())
+        return got;
+    for (i = 0; i < got; i++)
+        records[i] = trace_load_le64((const unsigned char *)&records[i]);
+    return got;
+}
@@ -0,0 +1,83 @@
+/*
+ * tracefile.h - Binary trace format shared by synthtrace, csim and csimd
+ *
+ * A binary trace starts with the 8 byte magic TRACE_MAGIC and is
+ * followed by one 64-bit record per access, always stored little-endian
+ * (least significant byte first) whatever the host's byte order:
+ *
+ *     bits  0..47  address
+ *     bits 48..55  access size in bytes
+ *     bits 56..63  operation character ('I', 'L', 'S' or 'M')
+ *
+ * Text traces are the usual valgrind lackey format (" L 10,1").
+ * tracefile.c recognizes and reads binary traces for the simulators.
+ */
+#ifndef TRACEFILE_H
+#define TRACEFILE_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+typedef unsigned long long int address_t; // this would be a pain to type out more than once
+
+#define TRACE_MAGIC "CSIMTRC1"
+#define TRACE_MAGIC_LEN 8
+
+#define TRACE_ADDR_MASK ((1ULL << 48) - 1)
+
+/* Pack / unpack a single binary record */
+#define TRACE_PACK(op, size, addr) \
+    (((uint64_t)(unsigned char)(op) << 56) | \
+     ((uint64_t)((size) & 0xff) << 48) | \
+     ((uint64_t)(addr) & TRACE_ADDR_MASK))
+#define TRACE_OP(rec)   ((char)((rec) >> 56))
+#define TRACE_SIZE(rec) ((int)(((rec) >> 48) & 0xff))
+#define TRACE_ADDR(rec) ((rec) & TRACE_ADDR_MASK)
+
+/* trace_host_is_le - 1 on a little-endian host (folds to a constant) */
+static inline int trace_host_is_le(void)
+{
+    const union { uint64_t word; unsigned char bytes[8]; } probe = { 1 };
+
+    return probe.bytes[0] == 1;
+}
+
+/* trace_store_le64 - Store a record at p in the file's byte order */
+static inline void trace_store_le64(unsigned char *p, uint64_t rec)
+{
+    int i;
+
+    if (trace_host_is_le()) {
+        memcpy(p, &rec, sizeof(rec));
+        return;
+    }
+    for (i = 0; i < 8; i++)
+        p[i] = (unsigned char)(rec >> (8 * i));
+}
+
+/* trace_load_le64 - Load a record stored at p in the file's byte order */
+static inline uint64_t trace_load_le64(const unsigned char *p)
+{
+    uint64_t rec = 0;
+    int i;
+
+    if (trace_host_is_le()) {
+        memcpy(&rec, p, sizeof(rec));
+        return rec;
+    }
+    for (i = 0; i < 8; i++)
+        rec |= (uint64_t)p[i] << (8 * i);
+    return rec;
+}
+
+/* trace_is_binary - Check for the magic. Consumes it and returns 1 for
+ *     a binary trace, rewinds and returns 0 for a text trace. */
+int trace_is_binary(FILE *fp);
+
+/* trace_read_binary - Read up to max records of a binary trace into host
+ *     order. Returns the number read, fewer than max only at the end of
+ *     the trace. */
+size_t trace_read_binary(FILE *fp, uint64_t *records, size_t max);
+
+#endif /* TRACEFILE_H */
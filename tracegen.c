@@ -4,7 +4,9 @@
  * 
  * The beginning and end of each registered transpose function's trace
  * is indicated by reading from "marker" addresses. These two marker
- * addresses are recorded in file for later use.
+ * addresses are recorded in file for later use. The file defaults to
+ * .marker and can be changed with -m so that several tracegen runs can
+ * go at once.
  */
 
 #include <stdlib.h>
@@ -51,7 +53,8 @@ int main(int argc, char* argv[]){
 
     char c;
     int selectedFunc=-1;
-    while( (c=getopt(argc,argv,"M:N:F:")) != -1){
+    char *markerFile = ".marker";
+    while( (c=getopt(argc,argv,"M:N:F:m:")) != -1){
         switch(c){
         case 'M':
             M = atoi(optarg);
@@ -62,6 +65,9 @@ int main(int argc, char* argv[]){
         case 'F':
             selectedFunc = atoi(optarg);
             break;
+        case 'm':
+            markerFile = optarg;
+            break;
         case '?':
         default:
             printf("./tracegen failed to parse its options.\n");
@@ -77,7 +83,7 @@ int main(int argc, char* argv[]){
     initMatrix(M,N, A, B); 
 
     /* Record marker addresses */
-    FILE* marker_fp = fopen(".marker","w");
+    FILE* marker_fp = fopen(markerFile,"w");
     assert(marker_fp);
     fprintf(marker_fp, "%llx %llx", 
             (unsigned long long int) &MARKER_START,
@@ -8,6 +8,7 @@
  * on a 1KB direct mapped cache with a block size of 32 bytes.
  */ 
 #include <stdio.h>
+#include <string.h>
 #include "cachelab.h"
 
 int is_transpose(int M, int N, int A[N][M], int B[M][N]);
@@ -128,6 +129,129 @@ void transpose_submit(int M, int N, int A[N][M], int B[M][N]) {
 
 // }
 
+/*
+ * Element-size generic transpose kernels.
+ *
+ * The kernels below are stamped out once per element size by the
+ * DEFINE_TRANSPOSE_KERNELS macro, so every element type gets its own
+ * copy of the blocked loops with a fixed-size load/store instead of a
+ * memcpy of elemSize bytes. transpose_generic() and
+ * transpose_square_inplace() pick the right copy with a switch on
+ * elemSize. Matrices are row-major: A has N rows of M elements, and
+ * B has M rows of N elements, exactly like the int kernels above.
+ */
+
+/* 16 byte elements have no portable C99 integer type, so wrap two words */
+typedef struct {
+    unsigned long long word[2];
+} elem16_t;
+
+/* Block edge used by the generic kernels, in elements */
+#define TRANS_BLOCK 8
+
+#define DEFINE_TRANSPOSE_KERNELS(suffix, type)                              \
+static void transpose_##suffix(int M, int N, const type *A, type *B) {     \
+    int i, j, rowBlock, colBlock;                                           \
+                                                                            \
+    for (rowBlock = 0; rowBlock < N; rowBlock += TRANS_BLOCK) {             \
+        for (colBlock = 0; colBlock < M; colBlock += TRANS_BLOCK) {         \
+            for (i = rowBlock; (i < rowBlock + TRANS_BLOCK) && (i < N); i++) { \
+                for (j = colBlock; (j < colBlock + TRANS_BLOCK) && (j < M); j++) { \
+                    B[(long)j * N + i] = A[(long)i * M + j];                \
+                }                                                           \
+            }                                                               \
+        }                                                                   \
+    }                                                                       \
+}                                                                           \
+                                                                            \
+static void transpose_inplace_##suffix(int N, type *A) {                   \
+    int i, j, rowBlock, colBlock;                                           \
+    type temp;                                                              \
+                                                                            \
+    /* Only visit blocks on or above the diagonal. Each one is swapped   */ \
+    /* with its mirror block below the diagonal, one element pair at a   */ \
+    /* time, so both blocks stay resident while they are being swapped.  */ \
+    for (rowBlock = 0; rowBlock < N; rowBlock += TRANS_BLOCK) {             \
+        for (colBlock = rowBlock; colBlock < N; colBlock += TRANS_BLOCK) {  \
+            for (i = rowBlock; (i < rowBlock + TRANS_BLOCK) && (i < N); i++) { \
+                /* on a diagonal block, only swap above the diagonal */     \
+                j = (rowBlock == colBlock) ? i + 1 : colBlock;              \
+                for (; (j < colBlock + TRANS_BLOCK) && (j < N); j++) {      \
+                    temp = A[(long)i * N + j];                              \
+                    A[(long)i * N + j] = A[(long)j * N + i];                \
+                    A[(long)j * N + i] = temp;                              \
+                }                                                           \
+            }                                                               \
+        }                                                                   \
+    }                                                                       \
+}
+
+DEFINE_TRANSPOSE_KERNELS(1, unsigned char)
+DEFINE_TRANSPOSE_KERNELS(2, unsigned short)
+DEFINE_TRANSPOSE_KERNELS(4, unsigned int)
+DEFINE_TRANSPOSE_KERNELS(8, unsigned long long)
+DEFINE_TRANSPOSE_KERNELS(16, elem16_t)
+
+/*
+ * transpose_generic - Out-of-place transpose of an N x M matrix A into
+ *     the M x N matrix B for elements of 1, 2, 4, 8 or 16 bytes.
+ *     Returns 0 on success, -1 if elemSize is not supported.
+ */
+int transpose_generic(size_t elemSize, int M, int N, const void *A, void *B) {
+    switch (elemSize) {
+    case 1:  transpose_1(M, N, A, B);  return 0;
+    case 2:  transpose_2(M, N, A, B);  return 0;
+    case 4:  transpose_4(M, N, A, B);  return 0;
+    case 8:  transpose_8(M, N, A, B);  return 0;
+    case 16: transpose_16(M, N, A, B); return 0;
+    default: return -1;
+    }
+}
+
+/*
+ * transpose_square_inplace - Transpose the N x N matrix A in place for
+ *     elements of 1, 2, 4, 8 or 16 bytes.
+ *     Returns 0 on success, -1 if elemSize is not supported.
+ */
+int transpose_square_inplace(size_t elemSize, int N, void *A) {
+    switch (elemSize) {
+    case 1:  transpose_inplace_1(N, A);  return 0;
+    case 2:  transpose_inplace_2(N, A);  return 0;
+    case 4:  transpose_inplace_4(N, A);  return 0;
+    case 8:  transpose_inplace_8(N, A);  return 0;
+    case 16: transpose_inplace_16(N, A); return 0;
+    default: return -1;
+    }
+}
+
+/*
+ * trans_generic - Runs the int case through transpose_generic() so the
+ *     generic kernels get checked against correctTrans() like any other
+ *     registered function.
+ */
+char trans_generic_desc[] = "Generic element-size blocked transpose";
+void trans_generic(int M, int N, int A[N][M], int B[M][N]) {
+    transpose_generic(sizeof(int), M, N, A, B);
+}
+
+/*
+ * trans_inplace - Copy-then-transpose: copies A into B, then transposes
+ *     B in place with transpose_square_inplace(). The driver checks B
+ *     against A, so this can't transpose A itself, and its miss count
+ *     includes the copy. The in-place kernel alone is checked on every
+ *     element size by test-trans. It only makes sense for square
+ *     matrices, so other shapes fall back to the out-of-place kernel.
+ */
+char trans_inplace_desc[] = "Copy, then in-place blocked diagonal-swap transpose";
+void trans_inplace(int M, int N, int A[N][M], int B[M][N]) {
+    if (M != N) {
+        transpose_generic(sizeof(int), M, N, A, B);
+        return;
+    }
+    memcpy(B, A, sizeof(int) * M * N);
+    transpose_square_inplace(sizeof(int), N, B);
+}
+
 /*
  * registerFunctions - This function registers your transpose
  *     functions with the driver.  At runtime, the driver will
@@ -141,6 +265,8 @@ void registerFunctions() {
 
     /* Register any additional transpose functions */
     // registerTransFunction(trans, trans_desc); 
+    registerTransFunction(trans_generic, trans_generic_desc);
+    registerTransFunction(trans_inplace, trans_inplace_desc);
 
 }
 
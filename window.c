@@ -0,0 +1,129 @@
+/* Time-windowed statistics and phase detection.
+ * A signature distance is the fraction of bits set in either signature that are set in only one of
+ * them (0 for the same working set, 1 for disjoint ones). The working-set size of a window is
+ * estimated from its signature by linear counting.
+ *
+ * Authors: Theodore Bieber (tjbieber), James Honicker (jlhonicker)
+*/
+#include "window.h"
+#include <math.h>
+#include <string.h>
+
+windowStats createWindowStats(FILE *out, unsigned long long windowSize, int blocks, double threshold) {
+	windowStats windows;
+
+	memset(&windows, 0, sizeof(windows));
+	windows.out = out;
+	windows.windowSize = windowSize;
+	windows.blocks = blocks;
+	windows.threshold = threshold;
+	windows.phase = -1;
+
+	fprintf(out, "window,first_access,accesses,hits,misses,evictions,miss_rate");
+	if(threshold > 0) {
+		fprintf(out, ",working_set,distance,phase,phase_change");
+	}
+	fprintf(out, "\n");
+	return windows;
+}
+
+// Relative distance between two signatures
+static double signatureDistance(const unsigned long long *a, const unsigned long long *b) {
+	int wordcounter, either = 0, one = 0;
+
+	for(wordcounter = 0; wordcounter < SIGNATURE_WORDS; wordcounter++) {
+		either += __builtin_popcountll(a[wordcounter] | b[wordcounter]);
+		one += __builtin_popcountll(a[wordcounter] ^ b[wordcounter]);
+	}
+	return either == 0 ? 0 : (double) one / either;
+}
+
+// Estimated distinct blocks behind a signature (saturates once every bit is set)
+static double workingSetSize(const unsigned long long *signature) {
+	int wordcounter, zeros = SIGNATURE_BITS;
+
+	for(wordcounter = 0; wordcounter < SIGNATURE_WORDS; wordcounter++) {
+		zeros -= __builtin_popcountll(signature[wordcounter]);
+	}
+	if(zeros == 0) {
+		zeros = 1;
+	}
+	return SIGNATURE_BITS * log((double) SIGNATURE_BITS / zeros);
+}
+
+/* Picks the phase of a window that differs from the last one: the closest remembered phase within
+ * the threshold, or a new phase (replacing the least recently seen one if the table is full)
+*/
+static int findPhase(windowStats *windows) {
+	double bestDistance = windows->threshold;
+	int best = -1, phasecounter;
+
+	for(phasecounter = 0; phasecounter < windows->amtPhases; phasecounter++) {
+		double distance = signatureDistance(windows->signature, windows->phases[phasecounter].signature);
+		if(distance <= bestDistance) {
+			bestDistance = distance;
+			best = phasecounter;
+		}
+	}
+	if(best >= 0) {
+		return best;
+	}
+
+	if(windows->amtPhases < MAX_PHASES) {
+		best = windows->amtPhases++;
+	} else {
+		best = 0;
+		for(phasecounter = 1; phasecounter < MAX_PHASES; phasecounter++) {
+			if(windows->phases[phasecounter].lastSeen < windows->phases[best].lastSeen) {
+				best = phasecounter;
+			}
+		}
+	}
+	windows->phases[best].label = windows->nextLabel++;
+	return best;
+}
+
+void writeWindow(windowStats *windows, unsigned long long accesses, unsigned long long hits,
+		unsigned long long misses, unsigned long long evictions) {
+	unsigned long long windowHits = hits - windows->startHits;
+	unsigned long long windowMisses = misses - windows->startMisses;
+
+	fprintf(windows->out, "%llu,%llu,%llu,%llu,%llu,%llu,%.6f", windows->windows, windows->start,
+		accesses - windows->start, windowHits, windowMisses, evictions - windows->startEvictions,
+		windowHits + windowMisses > 0 ? (double) windowMisses / (windowHits + windowMisses) : 0);
+
+	if(windows->threshold > 0) {
+		double distance = windows->phase < 0 ? 1 : signatureDistance(windows->signature,
+			windows->previous);
+		int phase = windows->phase;
+		int previousLabel = phase < 0 ? -1 : windows->phases[phase].label;
+
+		if(phase < 0 || distance > windows->threshold) {
+			phase = findPhase(windows);
+		}
+		// the phase's signature follows its latest window, so slow drift stays in the same phase
+		memcpy(windows->phases[phase].signature, windows->signature, sizeof(windows->signature));
+		windows->phases[phase].lastSeen = windows->windows;
+		fprintf(windows->out, ",%.0f,%.4f,%d,%d", workingSetSize(windows->signature), distance,
+			windows->phases[phase].label, windows->phases[phase].label != previousLabel);
+
+		windows->phase = phase;
+		memcpy(windows->previous, windows->signature, sizeof(windows->signature));
+		memset(windows->signature, 0, sizeof(windows->signature));
+	}
+	fprintf(windows->out, "\n");
+	fflush(windows->out);
+
+	windows->windows++;
+	windows->start = accesses;
+	windows->startHits = hits;
+	windows->startMisses = misses;
+	windows->startEvictions = evictions;
+}
+
+void finishWindowStats(windowStats *windows, unsigned long long accesses, unsigned long long hits,
+		unsigned long long misses, unsigned long long evictions) {
+	if(accesses > windows->start) {
+		writeWindow(windows, accesses, hits, misses, evictions);
+	}
+}
@@ -0,0 +1,83 @@
+/* Time-windowed statistics and phase detection.
+ * Every windowSize accesses one CSV row is written with the hits, misses, evictions and miss rate
+ * of that window, so memory stays the same however long the trace is. With phase detection on,
+ * each window also gets a working-set signature: a bit vector with one bit set per hashed block
+ * address. Consecutive windows whose signatures differ by more than a threshold start a new phase,
+ * and a phase whose signature matches an earlier one gets that phase's label back.
+ *
+ * Authors: Theodore Bieber (tjbieber), James Honicker (jlhonicker)
+*/
+#ifndef WINDOW_H
+#define WINDOW_H
+
+#include <stdio.h>
+
+// Bits in a working-set signature
+#define SIGNATURE_LOG 14
+#define SIGNATURE_BITS (1 << SIGNATURE_LOG)
+#define SIGNATURE_WORDS (SIGNATURE_BITS / 64)
+// Most phase signatures remembered for relabeling, the least recently seen one is replaced
+#define MAX_PHASES 64
+
+typedef struct {
+	unsigned long long signature[SIGNATURE_WORDS];
+	int label;
+	unsigned long long lastSeen; // window number
+} phaseEntry;
+
+typedef struct {
+	FILE *out;
+	unsigned long long windowSize; // K
+	int blocks; // b
+	unsigned long long windows; // rows written so far
+	unsigned long long start; // accesses, hits, misses and evictions when the window started
+	unsigned long long startHits;
+	unsigned long long startMisses;
+	unsigned long long startEvictions;
+	double threshold; // relative signature distance of a phase change, 0 for no detection
+	unsigned long long signature[SIGNATURE_WORDS]; // this window's
+	unsigned long long previous[SIGNATURE_WORDS]; // the last window's
+	phaseEntry phases[MAX_PHASES];
+	int amtPhases; // entries used in phases
+	int nextLabel;
+	int phase; // index into phases of the current phase, -1 before the first window
+} windowStats;
+
+/* Starts the CSV (writes its header)
+ * Parameters:
+ *     out: where the rows go, flushed after each one
+ *     windowSize: accesses per window
+ *     blocks: b, signatures are over block addresses
+ *     threshold: relative distance (0-1) between signatures that starts a new phase, 0 for none
+*/
+windowStats createWindowStats(FILE *out, unsigned long long windowSize, int blocks, double threshold);
+
+// Adds an access to the current window's signature
+static inline void windowAccess(windowStats *windows, unsigned long long address) {
+	if(windows->threshold > 0) {
+		unsigned long long bit = ((address >> windows->blocks) * 0x9e3779b97f4a7c15ULL) >>
+			(64 - SIGNATURE_LOG);
+		windows->signature[bit / 64] |= 1ULL << (bit % 64);
+	}
+}
+
+/* Writes the current window's row and starts the next window
+ * Parameters:
+ *     accesses, hits, misses, evictions: the running totals
+*/
+void writeWindow(windowStats *windows, unsigned long long accesses, unsigned long long hits,
+		unsigned long long misses, unsigned long long evictions);
+
+// Writes a row once the window is full, called after every access
+static inline void windowCheck(windowStats *windows, unsigned long long accesses,
+		unsigned long long hits, unsigned long long misses, unsigned long long evictions) {
+	if(accesses - windows->start >= windows->windowSize) {
+		writeWindow(windows, accesses, hits, misses, evictions);
+	}
+}
+
+// Writes the last, partial window (if it has any accesses)
+void finishWindowStats(windowStats *windows, unsigned long long accesses, unsigned long long hits,
+		unsigned long long misses, unsigned long long evictions);
+
+#endif /* WINDOW_H */